@@ -0,0 +1,678 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "devutils.h"
+
+#define LIBEXAMPLE_IMPLEMENTATION
+#define LIBEXAMPLE_PARALLEL
+#define LIBEXAMPLE_VALIDATE
+#include "build/libexample.h"
+// generated by ./build/tool --switch-lookup
+#include "build/lookup_switch.h"
+
+#include "stream.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLES_UNIT "cycles"
+#else
+#define CYCLES_UNIT "ns"
+#endif
+
+#define BENCH_STREAM_SIZE (64*1024*1024)
+#define BENCH_REPEAT 3
+#define BENCH_VINT_COUNT (1024*1024)
+#define BENCH_LOOKUP_COUNT (1024*1024)
+#define BENCH_SEEK_COUNT 1024
+#define BENCH_PACKET_SIZE 1500
+#define BENCH_WRITER_BUFFER (1024*1024)
+#define BENCH_LACED_BLOCKS (16*1024)
+
+double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+uint64_t cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return now()*1e9;
+#endif
+}
+
+// widths are 1..8, a width of 0 picks a random one for every vint
+Buffer make_vints(size_t count, int width) {
+    Buffer b = {0};
+    uint32_t seed = 1;
+    for (size_t i=0; i<count; i++) {
+        seed = seed * 1103515245 + 12345;
+        int w = width > 0 ? width : 1 + (int) ((seed >> 16) % 8);
+        seed = seed * 1103515245 + 12345;
+        uint64_t max = ((uint64_t) 1 << (7*w)) - 2;
+        put_size(&b, ((uint64_t) seed << 24 | i) % max, w);
+    }
+    return b;
+}
+
+// the vints of the stream in the order a parser meets them: the id and the size of every element
+// and the track number of every SimpleBlock, again from the start until there are `count` of them
+Buffer stream_vints(Buffer stream, size_t count) {
+    Buffer b = {0};
+    libexample_cursor_t cur;
+    libexample_element_t elem;
+    size_t n = 0;
+    while (n < count) {
+        libexample_cursor_init(&cur, stream.data, stream.count);
+        while (n < count && libexample_next(&cur, &elem) == LIBEXAMPLE_ELEMSTART) {
+            for (size_t i=elem.header_offset; i<elem.body_offset; i++) buffer_push(&b, stream.data[i]);
+            n += 2;
+            if (elem.id == 0xA3 && n < count) {
+                buffer_push(&b, elem.body[0]);
+                n++;
+            }
+        }
+    }
+    return b;
+}
+
+// the byte at a time decoding the parser used before vint_decode
+uint64_t decode_vints_reference(Buffer b) {
+    uint64_t sum = 0;
+    size_t i = 0;
+    while (i < b.count) {
+        size_t width = 1;
+        for (uint8_t mark = 0x80; (mark & b.data[i]) == 0; mark >>= 1) width++;
+        uint8_t mask = ~0;
+        while (mask >= b.data[i]) mask >>= 1;
+        uint64_t v = mask & b.data[i];
+        for (size_t j=1; j<width; j++) v = (v << 8) + b.data[i+j];
+        sum += v;
+        i += width;
+    }
+    return sum;
+}
+
+uint64_t decode_vints(Buffer b) {
+    uint64_t sum = 0;
+    size_t i = 0;
+    while (i < b.count) {
+        uint64_t v;
+        size_t width = vint_decode(b.data + i, b.count - i, &v, false);
+        assert(width > 0);
+        sum += v;
+        i += width;
+    }
+    return sum;
+}
+
+double cycles_per_vint(Buffer b, uint64_t (*decode)(Buffer), uint64_t *sum) {
+    uint64_t best = 0;
+    for (size_t i=0; i<BENCH_REPEAT; i++) {
+        uint64_t start = cycles();
+        *sum = decode(b);
+        uint64_t t = cycles() - start;
+        if (i == 0 || t < best) best = t;
+    }
+    return (double) best / BENCH_VINT_COUNT;
+}
+
+void report_vints(Buffer stream) {
+    for (int width=1; width<=10; width++) {
+        Buffer b = width == 10 ? stream_vints(stream, BENCH_VINT_COUNT) : make_vints(BENCH_VINT_COUNT, width % 9);
+        uint64_t sum_reference;
+        uint64_t sum;
+        double reference = cycles_per_vint(b, decode_vints_reference, &sum_reference);
+        double kernel = cycles_per_vint(b, decode_vints, &sum);
+        if (sum != sum_reference) UNREACHABLE("report_vints: decoders disagree");
+        if (width <= 8) {
+            printf("[INFO] vint width %d       %6.2f %s/vint (byte loop %6.2f)\n", width, kernel, CYCLES_UNIT, reference);
+        } else {
+            printf("[INFO] vint width %-8s%6.2f %s/vint (byte loop %6.2f)\n", width == 9 ? "mixed" : "stream", kernel, CYCLES_UNIT, reference);
+        }
+        free(b.data);
+    }
+}
+
+size_t bench_parse_bytes(Buffer b) {
+    libexample_parser_t p;
+    libexample_init(&p);
+    size_t events = 0;
+    for (size_t i=0; i<b.count; i++) {
+        libexample_return_t r = libexample_parse(&p, b.data[i]);
+        if (r == LIBEXAMPLE_ERR) UNREACHABLE("bench_parse_bytes: parse error");
+        if (r != LIBEXAMPLE_OK) events++;
+    }
+    return events;
+}
+
+size_t bench_parse_bytes_skip(Buffer b) {
+    libexample_parser_t p;
+    libexample_init(&p);
+    p.skip_binary = true;
+    size_t events = 0;
+    for (size_t i=0; i<b.count; i++) {
+        libexample_return_t r = libexample_parse(&p, b.data[i]);
+        if (r == LIBEXAMPLE_ERR) UNREACHABLE("bench_parse_bytes_skip: parse error");
+        if (r != LIBEXAMPLE_OK) events++;
+        if (r == LIBEXAMPLE_SKIP) {
+            i += p.skip_bytes;
+            libexample_skip(&p);
+        }
+    }
+    return events;
+}
+
+size_t bench_parse_buffer(Buffer b) {
+    libexample_parser_t p;
+    libexample_init(&p);
+    size_t events = 0;
+    size_t i = 0;
+    while (i < b.count) {
+        size_t consumed;
+        libexample_return_t r = libexample_parse_buffer(&p, b.data + i, b.count - i, &consumed);
+        if (r == LIBEXAMPLE_ERR) UNREACHABLE("bench_parse_buffer: parse error");
+        if (r != LIBEXAMPLE_OK) events++;
+        i += consumed;
+    }
+    return events;
+}
+
+size_t bench_parse_buffer_skip(Buffer b) {
+    libexample_parser_t p;
+    libexample_init(&p);
+    p.skip_binary = true;
+    size_t events = 0;
+    size_t i = 0;
+    while (i < b.count) {
+        size_t consumed;
+        libexample_return_t r = libexample_parse_buffer(&p, b.data + i, b.count - i, &consumed);
+        if (r == LIBEXAMPLE_ERR) UNREACHABLE("bench_parse_buffer_skip: parse error");
+        if (r != LIBEXAMPLE_OK) events++;
+        i += consumed;
+        if (r == LIBEXAMPLE_SKIP) {
+            i += p.skip_bytes;
+            libexample_skip(&p);
+        }
+    }
+    return events;
+}
+
+size_t bench_parse_buffer_validate(Buffer b) {
+    libexample_validation_t v = {0};
+    libexample_parser_t p;
+    libexample_init(&p);
+    p.validation = &v;
+    size_t events = 0;
+    size_t i = 0;
+    while (i < b.count) {
+        size_t consumed;
+        libexample_return_t r = libexample_parse_buffer(&p, b.data + i, b.count - i, &consumed);
+        if (r == LIBEXAMPLE_ERR) UNREACHABLE("bench_parse_buffer_validate: parse error");
+        if (r != LIBEXAMPLE_OK) events++;
+        i += consumed;
+    }
+    return events;
+}
+
+size_t bench_parse_buffer_filter(Buffer b) {
+    libexample_filter_t f;
+    libexample_filter_init(&f);
+    if (!libexample_filter_add(&f, "\\Segment\\Info")) UNREACHABLE("bench_parse_buffer_filter: unknown path");
+    if (!libexample_filter_add(&f, "\\Segment\\Tracks")) UNREACHABLE("bench_parse_buffer_filter: unknown path");
+    libexample_parser_t p;
+    libexample_init(&p);
+    p.filter = &f;
+    size_t events = 0;
+    size_t i = 0;
+    while (i < b.count) {
+        size_t consumed;
+        libexample_return_t r = libexample_parse_buffer(&p, b.data + i, b.count - i, &consumed);
+        if (r == LIBEXAMPLE_ERR) UNREACHABLE("bench_parse_buffer_filter: parse error");
+        if (r != LIBEXAMPLE_OK) events++;
+        i += consumed;
+        if (r == LIBEXAMPLE_SKIP) {
+            i += p.skip_bytes;
+            libexample_skip(&p);
+        }
+    }
+    return events;
+}
+
+size_t bench_cursor(Buffer b) {
+    libexample_cursor_t cur;
+    libexample_cursor_init(&cur, b.data, b.count);
+    size_t events = 0;
+    libexample_element_t elem;
+    for (libexample_return_t r = libexample_next(&cur, &elem); r != LIBEXAMPLE_OK; r = libexample_next(&cur, &elem)) {
+        if (r == LIBEXAMPLE_ERR) UNREACHABLE("bench_cursor: parse error");
+        events++;
+    }
+    return events;
+}
+
+void count_block(void *user, const libexample_byte_t *value, size_t length) {
+    UNUSED(value);
+    UNUSED(length);
+    *(size_t *) user += 1;
+}
+
+void count_timestamp(void *user, uint64_t value) {
+    UNUSED(value);
+    *(size_t *) user += 1;
+}
+
+size_t bench_visit(Buffer b) {
+    libexample_visitor_t v = {
+        .on_SimpleBlock = count_block,
+        .on_Timestamp   = count_timestamp,
+    };
+    size_t events = 0;
+    if (libexample_visit(&v, &events, b.data, b.count) == LIBEXAMPLE_ERR) UNREACHABLE("bench_visit: parse error");
+    return events;
+}
+
+void report(const char *label, Buffer b, size_t (*bench)(Buffer)) {
+    double best = 0;
+    size_t events = 0;
+    for (size_t i=0; i<BENCH_REPEAT; i++) {
+        double start = now();
+        events = bench(b);
+        double t = now() - start;
+        if (i == 0 || t < best) best = t;
+    }
+    printf("[INFO] %-28s %10.1f MB/s %12zu events\n", label, b.count / best / 1e6, events);
+}
+
+double cycles_per_lookup(uint64_t *ids, size_t count, int (*lookup_func)(uint64_t), int64_t *sum) {
+    uint64_t best = 0;
+    for (size_t i=0; i<BENCH_REPEAT; i++) {
+        uint64_t start = cycles();
+        *sum = 0;
+        for (size_t j=0; j<count; j++) *sum += lookup_func(ids[j]);
+        uint64_t t = cycles() - start;
+        if (i == 0 || t < best) best = t;
+    }
+    return (double) best / count;
+}
+
+double cycles_per_child_lookup(uint64_t *ids, int *parents, size_t count, int64_t *sum) {
+    uint64_t best = 0;
+    for (size_t i=0; i<BENCH_REPEAT; i++) {
+        uint64_t start = cycles();
+        *sum = 0;
+        for (size_t j=0; j<count; j++) *sum += lookup_child(parents[j], ids[j]);
+        uint64_t t = cycles() - start;
+        if (i == 0 || t < best) best = t;
+    }
+    return (double) best / count;
+}
+
+void report_lookup(const char *label, uint64_t *ids, size_t count) {
+    int64_t sum_switch;
+    int64_t sum_hash;
+    double with_switch = cycles_per_lookup(ids, count, lookup_switch, &sum_switch);
+    double with_hash = cycles_per_lookup(ids, count, lookup, &sum_hash);
+    if (sum_switch != sum_hash) UNREACHABLE("report_lookup: lookups disagree");
+    printf("[INFO] lookup %-15s %6.2f %s/id (switch %6.2f)\n", label, with_hash, CYCLES_UNIT, with_switch);
+}
+
+// the ids of the stream within their parents, as the parser looks them up
+void report_child_lookup(uint64_t *ids, int *parents, size_t count) {
+    int64_t sum_hash;
+    int64_t sum_child;
+    double with_hash = cycles_per_lookup(ids, count, lookup, &sum_hash);
+    double with_child = cycles_per_child_lookup(ids, parents, count, &sum_child);
+    if (sum_hash != sum_child) UNREACHABLE("report_child_lookup: lookups disagree");
+    printf("[INFO] lookup_child %-9s %6.2f %s/id (hash %6.2f)\n", "in parent", with_child, CYCLES_UNIT, with_hash);
+}
+
+// the ids in the order they appear in the stream and the same amount of ids picked uniformly from the schema
+void report_lookups(Buffer b) {
+    uint64_t *ids = malloc(BENCH_LOOKUP_COUNT * sizeof(*ids));
+    int *parents = malloc(BENCH_LOOKUP_COUNT * sizeof(*parents));
+    int levels[LIBEXAMPLE_MAX_DEPTH];
+    size_t count = 0;
+    libexample_cursor_t cur;
+    libexample_cursor_init(&cur, b.data, b.count);
+    libexample_element_t elem;
+    while (count < BENCH_LOOKUP_COUNT && libexample_next(&cur, &elem) == LIBEXAMPLE_ELEMSTART) {
+        ids[count] = elem.id;
+        parents[count] = elem.depth > 1 ? levels[elem.depth-2] : -1;
+        levels[elem.depth-1] = elem.index;
+        count++;
+    }
+    report_lookup("stream ids", ids, count);
+    report_child_lookup(ids, parents, count);
+    free(parents);
+    uint32_t seed = 1;
+    for (size_t i=0; i<count; i++) {
+        seed = seed * 1103515245 + 12345;
+        ids[i] = element_ids[(seed >> 16) % ELEMENT_COUNT];
+    }
+    report_lookup("schema ids", ids, count);
+    free(ids);
+}
+
+libexample_return_t count_unit_events(void *user, size_t index, libexample_parser_t *p, const libexample_byte_t *data, size_t length) {
+    size_t *events = user;
+    size_t count = 0;
+    size_t i = 0;
+    while (i < length) {
+        size_t consumed;
+        libexample_return_t r = libexample_parse_buffer(p, data + i, length - i, &consumed);
+        if (r == LIBEXAMPLE_ERR) return LIBEXAMPLE_ERR;
+        if (r != LIBEXAMPLE_OK) count++;
+        i += consumed;
+    }
+    events[index] = count;
+    return LIBEXAMPLE_OK;
+}
+
+// parses the children of the Segment with an increasing number of threads, the events are merged in file order
+void report_parallel(Buffer b) {
+    libexample_cursor_t cur;
+    libexample_cursor_init(&cur, b.data, b.count);
+    libexample_element_t segment;
+    while (libexample_next(&cur, &segment) == LIBEXAMPLE_ELEMSTART && segment.id != 0x18538067) {}
+    size_t count = libexample_scan_children(&segment, NULL, 0);
+    uint64_t *offsets = malloc(count * sizeof(*offsets));
+    size_t *events = malloc(count * sizeof(*events));
+    libexample_scan_children(&segment, offsets, count);
+    size_t threads[] = {1, 2, 4, 8, 16, 32};
+    size_t expected = 0;
+    for (size_t t=0; t<sizeof(threads)/sizeof(threads[0]); t++) {
+        double best = 0;
+        for (size_t i=0; i<BENCH_REPEAT; i++) {
+            double start = now();
+            if (libexample_parse_parallel(&segment, offsets, count, threads[t], count_unit_events, events) != LIBEXAMPLE_OK) {
+                UNREACHABLE("report_parallel: parse error");
+            }
+            double seconds = now() - start;
+            if (i == 0 || seconds < best) best = seconds;
+        }
+        size_t total = 0;
+        for (size_t i=0; i<count; i++) total += events[i];
+        if (t == 0) expected = total;
+        if (total != expected) UNREACHABLE("report_parallel: events differ");
+        char label[64];
+        snprintf(label, sizeof(label), "libexample_parse_parallel/%zu", threads[t]);
+        printf("[INFO] %-28s %10.1f MB/s %12zu events\n", label, segment.body_length / best / 1e6, total);
+    }
+    free(offsets);
+    free(events);
+}
+
+size_t resync_scan_scalar(const libexample_byte_t *data, size_t count, size_t length) {
+    UNUSED(length);
+    for (size_t i=0; i<count; i++) {
+        if (resync_pair(data[i], data[i + 1])) return i;
+    }
+    return count;
+}
+
+void report_resync_scan(const char *label, Buffer b, size_t (*scan)(const libexample_byte_t *, size_t, size_t)) {
+    size_t count = b.count - 16;
+    double best = 0;
+    size_t hits = 0;
+    for (size_t r=0; r<BENCH_REPEAT; r++) {
+        double start = now();
+        hits = 0;
+        for (size_t at = scan(b.data, count, b.count); at < count; at += 1 + scan(b.data + at + 1, count - at - 1, b.count - at - 1)) hits++;
+        double seconds = now() - start;
+        if (r == 0 || seconds < best) best = seconds;
+    }
+    printf("[INFO] %-28s %10.1f MB/s %12zu candidates\n", label, b.count / best / 1e6, hits);
+}
+
+// damages every 64th Cluster and counts how many Clusters are still found with libexample_resync
+void report_resync(Buffer b) {
+    Buffer noise = {0};
+    uint32_t seed = 1;
+    for (size_t i=0; i<BENCH_STREAM_SIZE; i++) {
+        seed = seed * 1103515245 + 12345;
+        buffer_push(&noise, seed >> 24);
+    }
+#if defined(RESYNC_VECTOR)
+    report_resync_scan(RESYNC_VECTOR == 32 ? "resync_scan (avx2)" : "resync_scan (sse2)", noise, resync_scan);
+#endif
+    report_resync_scan("resync_scan (scalar)", noise, resync_scan_scalar);
+
+    Buffer damaged = {0};
+    for (size_t i=0; i<b.count; i++) buffer_push(&damaged, b.data[i]);
+    libexample_cursor_t cur;
+    libexample_cursor_init(&cur, b.data, b.count);
+    libexample_element_t elem;
+    size_t clusters = 0;
+    while (libexample_next(&cur, &elem) == LIBEXAMPLE_ELEMSTART) {
+        if (elem.id != 0x1F43B675) continue;
+        if (clusters % 64 == 1) {
+            for (size_t i=0; i<256; i++) damaged.data[elem.body_offset + i] = noise.data[elem.body_offset + i];
+        }
+        clusters++;
+    }
+    libexample_parser_t p;
+    libexample_init(&p);
+    p.skip_binary = true;
+    size_t found = 0;
+    size_t errors = 0;
+    size_t i = 0;
+    while (i < damaged.count) {
+        size_t consumed;
+        libexample_return_t r = libexample_parse_buffer(&p, damaged.data + i, damaged.count - i, &consumed);
+        i += consumed;
+        if (r == LIBEXAMPLE_ERR) {
+            errors++;
+            if (libexample_resync(&p, damaged.data + i, damaged.count - i, &consumed) != LIBEXAMPLE_OK) break;
+            i += consumed;
+        } else if (r == LIBEXAMPLE_SKIP) {
+            i += p.skip_bytes;
+            libexample_skip(&p);
+        }
+        if ((r == LIBEXAMPLE_ELEMSTART || r == LIBEXAMPLE_SKIP) && p.id == 0x1F43B675) found++;
+    }
+    printf("[INFO] %-28s %zu of %zu clusters found after %zu errors, stopped at %zu of %zu bytes\n",
+           "libexample_resync", found, clusters, errors, i, damaged.count);
+    free(noise.data);
+    free(damaged.data);
+}
+
+typedef struct {
+    Buffer b;
+    size_t bytes_read;
+} Memory_Reader;
+
+// the data trickles in like from a socket
+size_t bench_parse_buffer_packets(Buffer b) {
+    libexample_parser_t p;
+    libexample_init(&p);
+    size_t events = 0;
+    size_t i = 0;
+    while (i < b.count) {
+        size_t end = i + BENCH_PACKET_SIZE < b.count ? i + BENCH_PACKET_SIZE : b.count;
+        while (i < end) {
+            size_t consumed;
+            libexample_return_t r = libexample_parse_buffer(&p, b.data + i, end - i, &consumed);
+            if (r == LIBEXAMPLE_ERR) UNREACHABLE("bench_parse_buffer_packets: parse error");
+            if (r != LIBEXAMPLE_OK) events++;
+            i += consumed;
+        }
+    }
+    return events;
+}
+
+void report_live(Buffer b) {
+    Buffer live = make_live(b);
+    report("libexample_parse_buffer live", live, bench_parse_buffer_packets);
+    report("libexample_next live", live, bench_cursor);
+    free(live.data);
+}
+
+size_t bench_remux(Buffer b) {
+    static libexample_byte_t buf[BENCH_WRITER_BUFFER];
+    int fd = open("/dev/null", O_WRONLY);
+    if (fd < 0) UNREACHABLE("bench_remux: open /dev/null");
+    libexample_writer_t w;
+    libexample_writer_init(&w, buf, sizeof(buf), fd);
+    size_t elements = remux(b, &w);
+    close(fd);
+    return elements;
+}
+
+// the stream as a tree, serialized with the smallest widths
+void report_serialize(Buffer b) {
+    size_t elements = bench_cursor(b);
+    libexample_node_t *pool = malloc(elements * sizeof(libexample_node_t));
+    assert(pool != NULL);
+    size_t count = count_children(b.data, b.count);
+    size_t used = count;
+    build_nodes(pool, pool, &used, b.data, b.count);
+    assert(used == elements);
+
+    Buffer compact = {0};
+    compact.capacity = libexample_serialize(pool, count, NULL, 0);
+    if (compact.capacity == 0) UNREACHABLE("report_serialize: invalid tree");
+    compact.data = malloc(compact.capacity);
+    assert(compact.data != NULL);
+    double best = 0;
+    for (size_t i=0; i<BENCH_REPEAT; i++) {
+        double start = now();
+        compact.count = libexample_serialize(pool, count, compact.data, compact.capacity);
+        double t = now() - start;
+        if (i == 0 || t < best) best = t;
+    }
+    printf("[INFO] %-28s %10.1f MB/s %12zu bytes (%zu bytes less)\n", "libexample_serialize", compact.count / best / 1e6, compact.count, b.count - compact.count);
+    free(compact.data);
+    free(pool);
+
+}
+
+// many small frames per block like an audio track, in all lacings
+void report_lacing(void) {
+    Buffer b = {0};
+    size_t *offsets = malloc((BENCH_LACED_BLOCKS + 1) * sizeof(size_t));
+    size_t *expected = malloc(BENCH_LACED_BLOCKS * LIBEXAMPLE_MAX_FRAMES * sizeof(size_t));
+    size_t *counts = malloc(BENCH_LACED_BLOCKS * sizeof(size_t));
+    assert(offsets != NULL && expected != NULL && counts != NULL);
+    uint32_t seed = 1;
+    size_t total_frames = 0;
+    for (size_t i=0; i<BENCH_LACED_BLOCKS; i++) {
+        int lacing = i % 4;
+        seed = seed * 1103515245 + 12345;
+        counts[i] = lacing == LIBEXAMPLE_LACING_NONE ? 1 : 8 + (seed >> 16) % 25;
+        offsets[i] = b.count;
+        put_laced_block(&b, lacing, counts[i], expected + total_frames, &seed);
+        total_frames += counts[i];
+    }
+    offsets[BENCH_LACED_BLOCKS] = b.count;
+
+    size_t sizes[LIBEXAMPLE_MAX_FRAMES];
+    uint64_t best = 0;
+    size_t sum = 0;
+    for (size_t k=0; k<BENCH_REPEAT; k++) {
+        uint64_t start = cycles();
+        for (size_t i=0; i<BENCH_LACED_BLOCKS; i++) {
+            libexample_block_t block;
+            libexample_block_decode(b.data + offsets[i], offsets[i+1] - offsets[i], &block, sizes, LIBEXAMPLE_MAX_FRAMES);
+            sum += sizes[block.frame_count - 1];
+        }
+        uint64_t t = cycles() - start;
+        if (k == 0 || t < best) best = t;
+    }
+    // the sum keeps the decoding from being optimized away
+    if (sum == 0) UNREACHABLE("report_lacing: no frames");
+    printf("[INFO] libexample_block_decode  %8.1f %s/block %6.2f %s/frame (%zu frames)\n",
+           (double) best / BENCH_LACED_BLOCKS, CYCLES_UNIT, (double) best / total_frames, CYCLES_UNIT, total_frames);
+    free(counts);
+    free(expected);
+    free(offsets);
+    free(b.data);
+}
+
+size_t read_memory(void *user, uint64_t offset, libexample_byte_t *buf, size_t length) {
+    Memory_Reader *m = user;
+    if (offset >= m->b.count) return 0;
+    if (length > m->b.count - offset) length = m->b.count - offset;
+    memcpy(buf, m->b.data + offset, length);
+    m->bytes_read += length;
+    return length;
+}
+
+// seeks to random times and checks that parsing resumes at the right Cluster
+void report_seek(Buffer b) {
+    size_t clusters = 0;
+    libexample_cursor_t cur;
+    libexample_cursor_init(&cur, b.data, b.count);
+    libexample_element_t elem;
+    while (libexample_next(&cur, &elem) == LIBEXAMPLE_ELEMSTART) {
+        if (elem.id == 0x1F43B675) clusters++;
+    }
+    Memory_Reader m = {b, 0};
+    libexample_reader_t r = {&m, read_memory};
+    libexample_parser_t p;
+    libexample_init(&p);
+    uint32_t seed = 1;
+    double seconds = 0;
+    for (size_t i=0; i<BENCH_SEEK_COUNT; i++) {
+        seed = seed * 1103515245 + 12345;
+        uint64_t target = (uint64_t) (seed >> 8) * 1000000000 / (1 << 24) * clusters;
+        uint64_t offset;
+        double start = now();
+        if (libexample_seek_time(&p, &r, 1, target, &offset) != LIBEXAMPLE_OK) UNREACHABLE("report_seek: seek failed");
+        seconds += now() - start;
+        // the first element has to be the Cluster at depth 2, followed by its Timestamp
+        size_t consumed;
+        libexample_return_t ret = libexample_parse_buffer(&p, b.data + offset, b.count - offset, &consumed);
+        if (ret != LIBEXAMPLE_ELEMSTART || p.id != 0x1F43B675 || p.this_depth != 2) UNREACHABLE("report_seek: not at a Cluster");
+        offset += consumed;
+        do {
+            ret = libexample_parse_buffer(&p, b.data + offset, b.count - offset, &consumed);
+            offset += consumed;
+        } while (ret != LIBEXAMPLE_ELEMEND);
+        if (p.value != target / 1000000000 * 1000) UNREACHABLE("report_seek: wrong Cluster");
+    }
+    printf("[INFO] %-30s %9.2f us/seek %9zu bytes read/seek (%zu clusters)\n", "libexample_seek_time",
+           seconds*1e6/BENCH_SEEK_COUNT, m.bytes_read/BENCH_SEEK_COUNT, clusters);
+}
+
+int main(int argc, char **argv) {
+    Buffer b = make_stream(BENCH_STREAM_SIZE);
+    if (argc > 1) {
+        // only dump the synthetic stream, e.g. to feed it into build/test
+        FILE *f = fopen(argv[1], "wb");
+        if (f == NULL) {
+            printf("[ERROR] Could not open file '%s': %s\n", argv[1], strerror(errno));
+            exit(1);
+        }
+        fwrite(b.data, 1, b.count, f);
+        fclose(f);
+        free(b.data);
+        return 0;
+    }
+    printf("[INFO] synthetic stream of %zu bytes\n", b.count);
+    report("libexample_parse", b, bench_parse_bytes);
+    report("libexample_parse+skip", b, bench_parse_bytes_skip);
+    report("libexample_parse_buffer", b, bench_parse_buffer);
+    report("libexample_parse_buffer+skip", b, bench_parse_buffer_skip);
+    report("libexample_parse_buffer+filter", b, bench_parse_buffer_filter);
+    report("libexample_parse_buffer+validate", b, bench_parse_buffer_validate);
+    report("libexample_next", b, bench_cursor);
+    report("libexample_visit", b, bench_visit);
+    report("libexample_writer /dev/null", b, bench_remux);
+    report_serialize(b);
+    report_lacing();
+    report_vints(b);
+    report_lookups(b);
+    report_live(b);
+    report_seek(b);
+    report_parallel(b);
+    report_resync(b);
+    free(b.data);
+    return 0;
+}
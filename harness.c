@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "devutils.h"
+
+#define LIBEXAMPLE_IMPLEMENTATION
+#define LIBEXAMPLE_PARALLEL
+#define LIBEXAMPLE_VALIDATE
+#include "build/libexample.h"
+
+// the streaming modes read the file through a buffer of this size
+#define HARNESS_CHUNK_SIZE (1024*1024)
+
+typedef enum {
+    MODE_PARSE,
+    MODE_PARSE_BUFFER,
+    MODE_PARSE_BUFFER_SKIP,
+    MODE_PARSE_BUFFER_FILTER,
+    MODE_PARSE_BUFFER_VALIDATE,
+    MODE_NEXT,
+    MODE_VISIT,
+    MODE_PARSE_PARALLEL,
+    MODE_COUNT,
+} Mode;
+
+const char *mode_label[] = {
+    [MODE_PARSE]                 = "libexample_parse",
+    [MODE_PARSE_BUFFER]          = "libexample_parse_buffer",
+    [MODE_PARSE_BUFFER_SKIP]     = "libexample_parse_buffer+skip",
+    [MODE_PARSE_BUFFER_FILTER]   = "libexample_parse_buffer+filter",
+    [MODE_PARSE_BUFFER_VALIDATE] = "libexample_parse_buffer+validate",
+    [MODE_NEXT]                  = "libexample_next",
+    [MODE_VISIT]                 = "libexample_visit+block_decode",
+    [MODE_PARSE_PARALLEL]        = "libexample_parse_parallel",
+};
+static_assert(sizeof(mode_label)/sizeof(mode_label[0]) == MODE_COUNT);
+
+double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// reads the whole file through one buffer, the bodies the parser skips are seeked over
+size_t stream_file(const char *path, libexample_parser_t *p, bool bytewise) {
+    static libexample_byte_t chunk[HARNESS_CHUNK_SIZE];
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) UNREACHABLE("stream_file: could not open the file");
+    size_t elements = 0;
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        size_t i = 0;
+        while (i < n) {
+            libexample_return_t r;
+            size_t consumed = 1;
+            if (bytewise) {
+                r = libexample_parse(p, chunk[i]);
+            } else {
+                r = libexample_parse_buffer(p, chunk + i, n - i, &consumed);
+            }
+            i += consumed;
+            if (r == LIBEXAMPLE_ERR) UNREACHABLE("stream_file: parse error");
+            if (r == LIBEXAMPLE_ELEMSTART || r == LIBEXAMPLE_SKIP) elements++;
+            if (r != LIBEXAMPLE_SKIP) continue;
+            uint64_t skip = p->skip_bytes;
+            libexample_skip(p);
+            if (skip <= n - i) {
+                i += skip;
+            } else {
+                if (fseek(f, skip - (n - i), SEEK_CUR) != 0) UNREACHABLE("stream_file: could not seek");
+                i = n;
+            }
+        }
+    }
+    fclose(f);
+    return elements;
+}
+
+void count_block(void *user, const libexample_byte_t *value, size_t length) {
+    size_t frame_sizes[LIBEXAMPLE_MAX_FRAMES];
+    libexample_block_t block;
+    if (libexample_block_decode(value, length, &block, frame_sizes, LIBEXAMPLE_MAX_FRAMES) != LIBEXAMPLE_OK) {
+        UNREACHABLE("count_block: malformed block");
+    }
+    *(size_t *) user += 1;
+}
+
+libexample_return_t count_unit_elements(void *user, size_t index, libexample_parser_t *p, const libexample_byte_t *data, size_t length) {
+    size_t *elements = user;
+    size_t count = 0;
+    size_t i = 0;
+    while (i < length) {
+        size_t consumed;
+        libexample_return_t r = libexample_parse_buffer(p, data + i, length - i, &consumed);
+        if (r == LIBEXAMPLE_ERR) return LIBEXAMPLE_ERR;
+        if (r == LIBEXAMPLE_ELEMSTART) count++;
+        i += consumed;
+    }
+    elements[index] = count;
+    return LIBEXAMPLE_OK;
+}
+
+// the mapped modes get the whole file, the Clusters are parsed on one thread per core
+size_t map_file(const char *path, Mode mode) {
+    size_t length;
+    const libexample_byte_t *data = libexample_mmap_open(path, &length);
+    if (data == NULL) UNREACHABLE("map_file: could not map the file");
+    size_t elements = 0;
+    if (mode == MODE_NEXT) {
+        libexample_cursor_t cur;
+        libexample_cursor_init(&cur, data, length);
+        libexample_element_t elem;
+        libexample_return_t r;
+        while ((r = libexample_next(&cur, &elem)) == LIBEXAMPLE_ELEMSTART) elements++;
+        if (r == LIBEXAMPLE_ERR) UNREACHABLE("map_file: parse error");
+    } else if (mode == MODE_VISIT) {
+        libexample_visitor_t v = {
+            .on_SimpleBlock = count_block,
+            .on_Block       = count_block,
+        };
+        if (libexample_visit(&v, &elements, data, length) == LIBEXAMPLE_ERR) UNREACHABLE("map_file: parse error");
+    } else {
+        libexample_cursor_t cur;
+        libexample_cursor_init(&cur, data, length);
+        libexample_element_t segment;
+        while (libexample_next(&cur, &segment) == LIBEXAMPLE_ELEMSTART && segment.id != 0x18538067) {}
+        size_t count = libexample_scan_children(&segment, NULL, 0);
+        uint64_t *offsets = malloc(count * sizeof(*offsets));
+        size_t *counts = malloc(count * sizeof(*counts));
+        assert(offsets != NULL && counts != NULL);
+        libexample_scan_children(&segment, offsets, count);
+        long threads = sysconf(_SC_NPROCESSORS_ONLN);
+        if (libexample_parse_parallel(&segment, offsets, count, threads > 0 ? threads : 1, count_unit_elements, counts) != LIBEXAMPLE_OK) {
+            UNREACHABLE("map_file: parse error");
+        }
+        for (size_t i=0; i<count; i++) elements += counts[i];
+        free(offsets);
+        free(counts);
+    }
+    libexample_mmap_close(data, length);
+    return elements;
+}
+
+size_t run_mode(const char *path, Mode mode) {
+    libexample_parser_t p;
+    libexample_init(&p);
+    libexample_filter_t f;
+    libexample_validation_t v = {0};
+    switch (mode) {
+        case MODE_PARSE:
+            return stream_file(path, &p, true);
+        case MODE_PARSE_BUFFER:
+            return stream_file(path, &p, false);
+        case MODE_PARSE_BUFFER_SKIP:
+            p.skip_binary = true;
+            return stream_file(path, &p, false);
+        case MODE_PARSE_BUFFER_FILTER:
+            libexample_filter_init(&f);
+            if (!libexample_filter_add(&f, "\\Segment\\Info")) UNREACHABLE("run_mode: unknown path");
+            if (!libexample_filter_add(&f, "\\Segment\\Tracks")) UNREACHABLE("run_mode: unknown path");
+            p.filter = &f;
+            return stream_file(path, &p, false);
+        case MODE_PARSE_BUFFER_VALIDATE:
+            p.validation = &v;
+            return stream_file(path, &p, false);
+        case MODE_NEXT:
+        case MODE_VISIT:
+        case MODE_PARSE_PARALLEL:
+            return map_file(path, mode);
+        case MODE_COUNT:
+            UNREACHABLE("MODE_COUNT is not a valid Mode");
+    }
+    UNREACHABLE("no valid Mode");
+}
+
+// every mode runs in its own process, so that the peak RSS is its own
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printf("Usage: %s <file>\n", argv[0]);
+        printf("       a corpus is written by ./build/tool --corpus <file>\n");
+        exit(0);
+    }
+    FILE *f = fopen(argv[1], "rb");
+    if (f == NULL) {
+        printf("[ERROR] Could not open file '%s': %s\n", argv[1], strerror(errno));
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    printf("[INFO] %s: %ld bytes\n", argv[1], size);
+    printf("[INFO] %-32s %12s %14s %14s\n", "mode", "MB/s", "elements/s", "peak RSS KiB");
+    fflush(stdout);
+
+    for (Mode mode=0; mode<MODE_COUNT; mode++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            printf("[ERROR] Could not fork: %s\n", strerror(errno));
+            exit(1);
+        }
+        if (pid == 0) {
+            double start = now();
+            size_t elements = run_mode(argv[1], mode);
+            double seconds = now() - start;
+            struct rusage usage;
+            getrusage(RUSAGE_SELF, &usage);
+            printf("[INFO] %-32s %12.1f %14.0f %14ld\n", mode_label[mode], size / seconds / 1e6, elements / seconds, usage.ru_maxrss);
+            fflush(stdout);
+            _exit(0);
+        }
+        int status;
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            printf("[ERROR] mode %s failed\n", mode_label[mode]);
+            exit(1);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,555 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "devutils.h"
+
+#define LIBEXAMPLE_IMPLEMENTATION
+#define LIBEXAMPLE_VALIDATE
+#define LIBEXAMPLE_STATS
+#if defined(TEST_MULTI)
+#include "build/libexample_multi.h"
+#else
+#include "build/libexample.h"
+#endif
+
+#include "stream.h"
+
+// small enough to run with every build, big enough for a few dozen Clusters
+#define TEST_STREAM_SIZE (256*1024)
+#define TEST_PACKET_SIZE 1500
+#define TEST_LACED_BLOCKS 256
+
+// all events of the parser with the data coming in packets of `packet_size` bytes, 0 on a parse error
+size_t parse_events(Buffer b, size_t packet_size) {
+    libexample_parser_t p;
+    libexample_init(&p);
+    size_t events = 0;
+    size_t i = 0;
+    while (i < b.count) {
+        size_t end = i + packet_size < b.count ? i + packet_size : b.count;
+        size_t consumed;
+        libexample_return_t r = libexample_parse_buffer(&p, b.data + i, end - i, &consumed);
+        if (r == LIBEXAMPLE_ERR) return 0;
+        if (r != LIBEXAMPLE_OK) events++;
+        i += consumed;
+    }
+    return events;
+}
+
+// all elements of the cursor, 0 on a parse error
+size_t cursor_elements(Buffer b) {
+    libexample_cursor_t cur;
+    libexample_cursor_init(&cur, b.data, b.count);
+    libexample_element_t elem;
+    size_t elements = 0;
+    libexample_return_t r;
+    while ((r = libexample_next(&cur, &elem)) == LIBEXAMPLE_ELEMSTART) elements++;
+    return r == LIBEXAMPLE_OK ? elements : 0;
+}
+
+// the typed values have to be the same whether their bodies are split over packets or not
+bool numbers_test(Buffer b) {
+    size_t packet_sizes[] = {1, 3, TEST_PACKET_SIZE};
+    for (size_t k=0; k<sizeof(packet_sizes)/sizeof(packet_sizes[0]); k++) {
+        libexample_parser_t p;
+        libexample_init(&p);
+        size_t checked = 0;
+        uint64_t last_id = 0;
+        size_t i = 0;
+        while (i < b.count && last_id != 0x1F43B675) {
+            size_t end = i + packet_sizes[k] < b.count ? i + packet_sizes[k] : b.count;
+            size_t consumed;
+            libexample_return_t r = libexample_parse_buffer(&p, b.data + i, end - i, &consumed);
+            i += consumed;
+            if (r == LIBEXAMPLE_ERR) return false;
+            if (r == LIBEXAMPLE_ELEMSTART) last_id = p.id;
+            if (r != LIBEXAMPLE_ELEMEND) continue;
+            bool valid = true;
+            switch (last_id) {
+                case 0x4489:   valid = p.float_value == STREAM_DURATION;              break;
+                case 0x4461:   valid = p.int_value == STREAM_DATE;                    break;
+                case 0x23314F: valid = p.float_value == STREAM_TRACK_TIMESTAMP_SCALE; break;
+                case 0x537F:   valid = p.int_value == STREAM_TRACK_OFFSET;            break;
+                default: continue;
+            }
+            if (!valid) {
+                printf("[ERROR] wrong value of element 0x%lX with packets of %zu bytes\n", last_id, packet_sizes[k]);
+                return false;
+            }
+            checked++;
+        }
+        if (checked != 4) return false;
+    }
+    return true;
+}
+
+// the unknown sizes must not change what the parser reports, also when the data trickles in like from a socket
+bool live_test(Buffer b) {
+    Buffer live = make_live(b);
+    size_t expected = parse_events(b, b.count);
+    bool same = expected > 0 && parse_events(live, TEST_PACKET_SIZE) == expected && cursor_elements(live) == cursor_elements(b);
+    free(live.data);
+    return same;
+}
+
+void count_violation(void *user, libexample_violation_t violation, uint64_t id, const char *name, uint64_t offset) {
+    UNUSED(id);
+    UNUSED(name);
+    UNUSED(offset);
+    ((size_t *) user)[violation] += 1;
+}
+
+// returns the violations of the stream by kind
+bool validate(Buffer b, size_t violations[LIBEXAMPLE_VIOLATION_COUNT]) {
+    libexample_validation_t v = {.on_violation = count_violation, .user = violations};
+    libexample_parser_t p;
+    libexample_init(&p);
+    p.validation = &v;
+    size_t i = 0;
+    while (i < b.count) {
+        size_t consumed;
+        if (libexample_parse_buffer(&p, b.data + i, b.count - i, &consumed) == LIBEXAMPLE_ERR) return false;
+        i += consumed;
+    }
+    libexample_eof(&p);
+    size_t sum = 0;
+    for (size_t k=0; k<LIBEXAMPLE_VIOLATION_COUNT; k++) sum += violations[k];
+    return sum == v.violations;
+}
+
+// the stream lacks MuxingApp, WritingApp, TrackUID and TrackType, a TrackNumber of 0 is out of range
+bool validation_test(Buffer b) {
+    size_t violations[LIBEXAMPLE_VIOLATION_COUNT] = {0};
+    if (!validate(b, violations)) return false;
+    if (violations[LIBEXAMPLE_VIOLATION_MISSING] != 4 || violations[LIBEXAMPLE_VIOLATION_RANGE] != 0) {
+        printf("[ERROR] got %zu missing and %zu out of range elements instead of 4 and 0\n",
+               violations[LIBEXAMPLE_VIOLATION_MISSING], violations[LIBEXAMPLE_VIOLATION_RANGE]);
+        return false;
+    }
+    libexample_cursor_t cur;
+    libexample_cursor_init(&cur, b.data, b.count);
+    libexample_element_t elem;
+    while (libexample_next(&cur, &elem) == LIBEXAMPLE_ELEMSTART && elem.id != 0xD7) {}
+    b.data[elem.body_offset] = 0;
+    memset(violations, 0, sizeof(violations));
+    bool parsed = validate(b, violations);
+    b.data[elem.body_offset] = 1;
+    return parsed && violations[LIBEXAMPLE_VIOLATION_RANGE] == 1;
+}
+
+// the number of elements the parser and the cursor report, -1 if one of them fails
+int64_t count_elements(Buffer b) {
+    libexample_parser_t p;
+    libexample_init(&p);
+    int64_t parsed = 0;
+    size_t i = 0;
+    while (i < b.count) {
+        size_t consumed;
+        libexample_return_t r = libexample_parse_buffer(&p, b.data + i, b.count - i, &consumed);
+        if (r == LIBEXAMPLE_ERR) return -1;
+        if (r == LIBEXAMPLE_ELEMSTART) parsed++;
+        i += consumed;
+    }
+    libexample_cursor_t cur;
+    libexample_cursor_init(&cur, b.data, b.count);
+    libexample_element_t elem;
+    int64_t visited = 0;
+    libexample_return_t r;
+    while ((r = libexample_next(&cur, &elem)) == LIBEXAMPLE_ELEMSTART) visited++;
+    return r == LIBEXAMPLE_OK && parsed == visited ? parsed : -1;
+}
+
+// an element in a parent it does not belong to is reported and skipped, here a Timestamp (of a Cluster) instead of the TrackNumber
+bool misplaced_test(Buffer b) {
+    int64_t count = count_elements(b);
+    libexample_cursor_t cur;
+    libexample_cursor_init(&cur, b.data, b.count);
+    libexample_element_t elem;
+    while (libexample_next(&cur, &elem) == LIBEXAMPLE_ELEMSTART && elem.id != 0xD7) {}
+    uint64_t at = elem.header_offset;
+    b.data[at] = 0xE7;
+    int64_t misplaced_count = count_elements(b);
+    size_t violations[LIBEXAMPLE_VIOLATION_COUNT] = {0};
+    bool parsed = validate(b, violations);
+    b.data[at] = 0xD7;
+    if (!parsed || violations[LIBEXAMPLE_VIOLATION_MISPLACED] != 1) {
+        printf("[ERROR] got %zu misplaced elements instead of 1\n", violations[LIBEXAMPLE_VIOLATION_MISPLACED]);
+        return false;
+    }
+    return count > 0 && misplaced_count == count - 1;
+}
+
+typedef struct {
+    uint64_t max_size_length;
+    uint64_t flag_default;
+    size_t flag_defaults;
+    double track_timestamp_scale;
+    char language[4];
+} Defaults;
+
+void on_max_size_length(void *user, uint64_t value)   { ((Defaults *) user)->max_size_length = value; }
+void on_track_timestamp_scale(void *user, double value) { ((Defaults *) user)->track_timestamp_scale = value; }
+
+void on_flag_default(void *user, uint64_t value) {
+    ((Defaults *) user)->flag_default = value;
+    ((Defaults *) user)->flag_defaults++;
+}
+
+void on_language(void *user, const char *value, size_t length) {
+    if (length < sizeof(((Defaults *) user)->language)) memcpy(((Defaults *) user)->language, value, length);
+}
+
+// the stream lacks EBMLMaxSizeLength, FlagDefault and Language, so their handlers get the defaults, the TrackTimestampScale is there
+bool defaults_test(Buffer b) {
+    libexample_visitor_t v = {
+        .on_EBMLMaxSizeLength   = on_max_size_length,
+        .on_FlagDefault         = on_flag_default,
+        .on_Language            = on_language,
+        .on_TrackTimestampScale = on_track_timestamp_scale,
+        .defaults               = true,
+    };
+    Defaults d = {0};
+    if (libexample_visit(&v, &d, b.data, b.count) != LIBEXAMPLE_OK) return false;
+    if (d.max_size_length != 8 || d.flag_default != 1 || d.flag_defaults != 1 || strcmp(d.language, "eng") != 0
+     || d.track_timestamp_scale != STREAM_TRACK_TIMESTAMP_SCALE) {
+        return false;
+    }
+    libexample_default_t value;
+    if (!libexample_default(0x2AD7B1, &value) || value.value != 1000000) return false;
+    return !libexample_default(0xD7, &value);
+}
+
+// once into memory and once into a file through a small buffer, so that most sizes are patched with pwrite
+bool remux_test(Buffer b) {
+    Buffer memory = {0};
+    memory.capacity = 2*b.count;
+    memory.data = malloc(memory.capacity);
+    assert(memory.data != NULL);
+    libexample_writer_t w;
+    libexample_writer_init(&w, memory.data, memory.capacity, -1);
+    remux(b, &w);
+    memory.count = w.count;
+
+    FILE *tmp = tmpfile();
+    if (tmp == NULL) UNREACHABLE("remux_test: tmpfile");
+    static libexample_byte_t buf[4*1024];
+    libexample_writer_init(&w, buf, sizeof(buf), fileno(tmp));
+    remux(b, &w);
+    Buffer file = {0};
+    file.capacity = w.offset;
+    file.data = malloc(file.capacity);
+    assert(file.data != NULL);
+    file.count = pread(fileno(tmp), file.data, file.capacity, 0);
+    fclose(tmp);
+
+    bool same = same_elements(b, memory) && file.count == memory.count && memcmp(file.data, memory.data, memory.count) == 0;
+    free(memory.data);
+    free(file.data);
+    return same;
+}
+
+// the stream as a tree, serialized with the smallest widths, has to give the same elements but be smaller
+bool serialize_test(Buffer b) {
+    size_t elements = cursor_elements(b);
+    libexample_node_t *pool = malloc(elements * sizeof(libexample_node_t));
+    assert(pool != NULL);
+    size_t count = count_children(b.data, b.count);
+    size_t used = count;
+    build_nodes(pool, pool, &used, b.data, b.count);
+    assert(used == elements);
+    Buffer compact = {0};
+    compact.capacity = libexample_serialize(pool, count, NULL, 0);
+    compact.data = malloc(compact.capacity > 0 ? compact.capacity : 1);
+    assert(compact.data != NULL);
+    compact.count = libexample_serialize(pool, count, compact.data, compact.capacity);
+    bool same = compact.capacity > 0 && compact.count == compact.capacity && compact.count < b.count && same_elements(b, compact);
+    free(compact.data);
+    free(pool);
+    if (!same) return false;
+
+    // with EBMLMaxSizeLength 1 no body can have more than 126 bytes
+    char doc_type[127];
+    memset(doc_type, 'x', sizeof(doc_type));
+    libexample_node_t header_children[] = {
+        { .id = 0x42F3, .value = 1 },
+        { .id = 0x4282, .data = (const libexample_byte_t *) doc_type, .length = 100 },
+    };
+    libexample_node_t header = { .id = 0x1A45DFA3, .children = header_children, .child_count = 2 };
+    libexample_byte_t out[256];
+    size_t fits = libexample_serialize(&header, 1, out, sizeof(out));
+    header_children[1].length = 127;
+    return fits > 0 && libexample_serialize(&header, 1, out, sizeof(out)) == 0;
+}
+
+// blocks in all lacings have to give their frames, cut off ones never frames beyond their end
+bool lacing_test(Buffer b) {
+    UNUSED(b);
+    Buffer blocks = {0};
+    size_t offsets[TEST_LACED_BLOCKS + 1];
+    size_t counts[TEST_LACED_BLOCKS];
+    size_t *expected = malloc(TEST_LACED_BLOCKS * LIBEXAMPLE_MAX_FRAMES * sizeof(size_t));
+    assert(expected != NULL);
+    uint32_t seed = 1;
+    size_t total_frames = 0;
+    for (size_t i=0; i<TEST_LACED_BLOCKS; i++) {
+        int lacing = i % 4;
+        seed = seed * 1103515245 + 12345;
+        counts[i] = lacing == LIBEXAMPLE_LACING_NONE ? 1 : 8 + (seed >> 16) % 25;
+        offsets[i] = blocks.count;
+        put_laced_block(&blocks, lacing, counts[i], expected + total_frames, &seed);
+        total_frames += counts[i];
+    }
+    offsets[TEST_LACED_BLOCKS] = blocks.count;
+
+    size_t sizes[LIBEXAMPLE_MAX_FRAMES];
+    size_t frame = 0;
+    bool valid = true;
+    for (size_t i=0; valid && i<TEST_LACED_BLOCKS; i++) {
+        libexample_block_t block;
+        size_t length = offsets[i+1] - offsets[i];
+        libexample_return_t r = libexample_block_decode(blocks.data + offsets[i], length, &block, sizes, LIBEXAMPLE_MAX_FRAMES);
+        valid = r == LIBEXAMPLE_OK && block.track == 2 && block.frame_count == counts[i]
+             && memcmp(sizes, expected + frame, counts[i] * sizeof(size_t)) == 0;
+        for (size_t cut=0; valid && cut<length && cut<64; cut++) {
+            if (libexample_block_decode(blocks.data + offsets[i], cut, &block, sizes, LIBEXAMPLE_MAX_FRAMES) != LIBEXAMPLE_OK) continue;
+            size_t sum = block.header_length;
+            for (size_t j=0; j<block.frame_count; j++) sum += sizes[j];
+            valid = sum == cut;
+        }
+        if (!valid) printf("[ERROR] wrong frames of laced block %zu (lacing %zu)\n", i, i % 4);
+        frame += counts[i];
+    }
+    free(expected);
+    free(blocks.data);
+    return valid;
+}
+
+size_t read_buffer(void *user, uint64_t offset, libexample_byte_t *buf, size_t length) {
+    Buffer *b = user;
+    if (offset >= b->count) return 0;
+    if (length > b->count - offset) length = b->count - offset;
+    memcpy(buf, b->data + offset, length);
+    return length;
+}
+
+// parses to the end with the settings of the parser, false on a parse error
+bool parse_rest(libexample_parser_t *p, Buffer b, size_t i) {
+    while (i < b.count) {
+        size_t consumed;
+        libexample_return_t r = libexample_parse_buffer(p, b.data + i, b.count - i, &consumed);
+        if (r == LIBEXAMPLE_ERR) return false;
+        i += consumed;
+        if (r == LIBEXAMPLE_SKIP) {
+            i += p->skip_bytes;
+            libexample_skip(p);
+        }
+    }
+    libexample_eof(p);
+    return true;
+}
+
+bool kept_doctype(const libexample_parser_t *p) {
+#ifdef LIBEXAMPLE_DOCTYPE_COUNT
+    return p->doctype == LIBEXAMPLE_DOCTYPE_MATROSKA;
+#else
+    UNUSED(p);
+    return true;
+#endif
+}
+
+// the Cluster at the offset libexample_seek_time gave, false if the seek failed
+bool seek_cluster(Buffer b, uint64_t timestamp_ns) {
+    libexample_reader_t r = {&b, read_buffer};
+    libexample_parser_t p;
+    libexample_init(&p);
+    uint64_t offset;
+    if (libexample_seek_time(&p, &r, 1, timestamp_ns, &offset) != LIBEXAMPLE_OK) return false;
+    size_t consumed;
+    return libexample_parse_buffer(&p, b.data + offset, b.count - offset, &consumed) == LIBEXAMPLE_ELEMSTART
+        && p.id == 0x1F43B675 && p.this_depth == 2;
+}
+
+// a live stream (Segment and Clusters of unknown size) seeks like a finished one, a file without EBML header
+// or with Cues larger than anything seek_time reads in one piece does not
+bool seek_test(Buffer b) {
+    Buffer live = make_live(b);
+    bool valid = seek_cluster(b, 1000000000) && seek_cluster(live, 1000000000);
+    free(live.data);
+
+    Buffer broken = {0};
+    for (size_t i=0; i<b.count; i++) buffer_push(&broken, b.data[i]);
+    broken.data[3] ^= 1;
+    valid = valid && !seek_cluster(broken, 1000000000);
+    broken.data[3] ^= 1;
+    libexample_cursor_t cur;
+    libexample_cursor_init(&cur, broken.data, broken.count);
+    libexample_element_t elem;
+    while (libexample_next(&cur, &elem) == LIBEXAMPLE_ELEMSTART && elem.id != 0x1C53BB6B) {}
+    broken.count = elem.header_offset + 4;
+    put_size(&broken, (uint64_t) 1 << 40, 8);
+    broken.count = b.count;
+    valid = valid && !seek_cluster(broken, 1000000000);
+    free(broken.data);
+    return valid;
+}
+
+// libexample_seek_time and libexample_resync start the parser again inside the Segment, what the user set has to stay
+bool reseed_test(Buffer b) {
+    size_t violations[LIBEXAMPLE_VIOLATION_COUNT] = {0};
+    libexample_validation_t v = {.on_violation = count_violation, .user = violations};
+    libexample_stats_t stats = {0};
+    libexample_parser_t p;
+    libexample_init(&p);
+    p.skip_binary = true;
+    p.validation = &v;
+    p.stats = &stats;
+    // the EBML header sets the DocType
+    size_t consumed;
+    size_t i = 0;
+    do {
+        if (libexample_parse_buffer(&p, b.data + i, b.count - i, &consumed) == LIBEXAMPLE_ERR) return false;
+        i += consumed;
+    } while (p.id != 0x18538067);
+    memset(&stats, 0, sizeof(stats));
+    libexample_reader_t r = {&b, read_buffer};
+    uint64_t offset;
+    if (libexample_seek_time(&p, &r, 1, 1000000000, &offset) != LIBEXAMPLE_OK) return false;
+    if (p.validation != &v || p.stats != &stats || !p.skip_binary || !kept_doctype(&p)) {
+        printf("[ERROR] libexample_seek_time dropped the settings of the parser\n");
+        return false;
+    }
+    // the Clusters have all their mandatory elements, the counting starts with the Cluster that was found
+    if (!parse_rest(&p, b, offset) || v.violations != 0) return false;
+    if (stats.elements[lookup(0x1A45DFA3)].count != 0 || stats.elements[lookup(0x1F43B675)].count == 0) return false;
+
+    libexample_cursor_t cur;
+    libexample_cursor_init(&cur, b.data, b.count);
+    libexample_element_t elem;
+    while (libexample_next(&cur, &elem) == LIBEXAMPLE_ELEMSTART && elem.id != 0x1F43B675) {}
+    Buffer damaged = {0};
+    for (size_t i=0; i<b.count; i++) buffer_push(&damaged, b.data[i]);
+    memset(damaged.data + elem.body_offset, 0xFF, 64);
+    libexample_init(&p);
+    p.skip_binary = true;
+    p.validation = &v;
+    p.stats = &stats;
+    i = 0;
+    libexample_return_t ret;
+    while ((ret = libexample_parse_buffer(&p, damaged.data + i, damaged.count - i, &consumed)) != LIBEXAMPLE_ERR) {
+        i += consumed;
+        if (ret == LIBEXAMPLE_SKIP) {
+            i += p.skip_bytes;
+            libexample_skip(&p);
+        }
+    }
+    i += consumed;
+    bool kept = libexample_resync(&p, damaged.data + i, damaged.count - i, &consumed) == LIBEXAMPLE_OK
+             && p.validation == &v && p.stats == &stats && p.skip_binary && kept_doctype(&p);
+    if (!kept) printf("[ERROR] libexample_resync dropped the settings of the parser\n");
+    // the Info and the Track still miss their four elements, nothing after the resync
+    kept = kept && parse_rest(&p, damaged, i + consumed) && violations[LIBEXAMPLE_VIOLATION_MISSING] == 4;
+    free(damaged.data);
+    return kept;
+}
+
+// an EBML laced block whose frame sizes sum up to exactly 2^64, so that the sum wraps to 0 and the last frame looks right
+bool lacing_overflow_test(Buffer b) {
+    UNUSED(b);
+    Buffer block = {0};
+    buffer_push(&block, 0x81);
+    buffer_push(&block, 0);
+    buffer_push(&block, 0);
+    buffer_push(&block, 0x80 | (LIBEXAMPLE_LACING_EBML << 1));
+    // 33 frames, the 32 sizes 47*2^50 + i*15*2^51 sum up to 32*47*2^50 + 496*15*2^51 = 2^64
+    buffer_push(&block, 32);
+    put_size(&block, (uint64_t) 47 << 50, 8);
+    for (size_t i=1; i<32; i++) put_size(&block, ((uint64_t) 15 << 51) + (((uint64_t) 1 << 55) - 1), 8);
+    for (size_t i=0; i<16; i++) buffer_push(&block, i);
+    size_t sizes[LIBEXAMPLE_MAX_FRAMES];
+    libexample_block_t decoded;
+    bool rejected = libexample_block_decode(block.data, block.count, &decoded, sizes, LIBEXAMPLE_MAX_FRAMES) == LIBEXAMPLE_ERR;
+    free(block.data);
+    return rejected;
+}
+
+// the TrackEntry has a TrackNumber and a TrackTimestampScale but no FlagDefault, asked for at the end of each of its children
+bool value_or_default_test(Buffer b) {
+    libexample_parser_t p;
+    libexample_init(&p);
+    libexample_element_t elem = {0};
+    libexample_default_t value;
+    size_t checked = 0;
+    size_t i = 0;
+    while (i < b.count) {
+        size_t consumed;
+        libexample_return_t r = libexample_parse_buffer(&p, b.data + i, b.count - i, &consumed);
+        i += consumed;
+        if (r == LIBEXAMPLE_ERR) return false;
+        if (r == LIBEXAMPLE_ELEMSTART) libexample_current(&p, &elem);
+        if (r != LIBEXAMPLE_ELEMEND) continue;
+        bool flag_default = libexample_value_or_default(&p, 0x88, &value) && value.value == 1;
+        switch (elem.id) {
+            case 0xD7:
+                if (!flag_default || !libexample_value_or_default(&p, 0xD7, &value) || value.value != 1) return false;
+                // not there yet
+                if (!libexample_value_or_default(&p, 0x23314F, &value) || value.float_value != 1.0) return false;
+                checked++;
+                break;
+            case 0x23314F:
+                if (!flag_default || !libexample_value_or_default(&p, 0x23314F, &value) || value.float_value != STREAM_TRACK_TIMESTAMP_SCALE) return false;
+                checked++;
+                break;
+            case 0x537F:
+                // the end of the TrackEntry, the TrackTimestampScale was there but its value is gone
+                if (!flag_default || libexample_value_or_default(&p, 0x23314F, &value)) return false;
+                checked++;
+                break;
+        }
+    }
+    // outside of a TrackEntry
+    return checked == 3 && !libexample_value_or_default(&p, 0x88, &value);
+}
+
+struct {
+    const char *name;
+    bool (*run)(Buffer b);
+} tests[] = {
+    {"numbers",     numbers_test},
+    {"live",        live_test},
+    {"validation",  validation_test},
+    {"misplaced",   misplaced_test},
+    {"defaults",    defaults_test},
+    {"value or default", value_or_default_test},
+    {"remux",       remux_test},
+    {"serialize",   serialize_test},
+    {"lacing",      lacing_test},
+    {"lacing overflow", lacing_overflow_test},
+    {"seek",        seek_test},
+    {"reseed",      reseed_test},
+};
+
+// the behavior of the generated library on a small synthetic stream, build/bench only measures it
+int main() {
+    Buffer b = make_stream(TEST_STREAM_SIZE);
+    bool failure = false;
+    for (size_t i=0; i<sizeof(tests)/sizeof(tests[0]); i++) {
+        printf("[INFO] running the %s test on a stream of %zu bytes\n", tests[i].name, b.count);
+        if (tests[i].run(b)) {
+            printf("[INFO] test passed\n");
+        } else {
+            failure = true;
+            printf("[ERROR] test not passed\n");
+        }
+    }
+    free(b.data);
+
+    if (failure) {
+        printf("[INFO] some tests have failed\n");
+        exit(1);
+    } else {
+        printf("[INFO] all tests have passed\n");
+        exit(0);
+    }
+}
@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "devutils.h"
+
+#define LIBEXAMPLE_IMPLEMENTATION
+#include "build/libexample.h"
+
+#define SIDECAR_IMPLEMENTATION
+#include "sidecar.h"
+
+#define ID_TIMESTAMP_SCALE 0x2AD7B1
+#define ID_CLUSTER         0x1F43B675
+#define ID_TIMESTAMP       0xE7
+#define ID_BLOCK_GROUP     0xA0
+#define ID_BLOCK           0xA1
+#define ID_REFERENCE_BLOCK 0xFB
+#define ID_SIMPLE_BLOCK    0xA3
+
+// track number (at most 8 bytes), timestamp and flags
+#define BLOCK_HEADER_MAX 11
+
+#define INPUT_CHUNK_SIZE (1024*1024)
+
+// a chunked reader, parse_buffer works on the chunks and skipped bodies are seeked over
+typedef struct {
+    FILE *file;
+    libexample_byte_t data[INPUT_CHUNK_SIZE];
+    size_t start;
+    size_t end;
+} Input;
+
+// makes sure that `want` bytes are buffered (unless the file ends first) and returns how many are
+size_t input_fill(Input *in, size_t want) {
+    if (in->end - in->start >= want) return in->end - in->start;
+    memmove(in->data, in->data + in->start, in->end - in->start);
+    in->end -= in->start;
+    in->start = 0;
+    while (in->end < want) {
+        size_t n = fread(in->data + in->end, 1, INPUT_CHUNK_SIZE - in->end, in->file);
+        if (n == 0) break;
+        in->end += n;
+    }
+    return in->end;
+}
+
+bool input_skip(Input *in, uint64_t n) {
+    if (n <= in->end - in->start) {
+        in->start += n;
+        return true;
+    }
+    n -= in->end - in->start;
+    in->start = in->end = 0;
+    return fseek(in->file, n, SEEK_CUR) == 0;
+}
+
+typedef struct {
+    void *items;
+    size_t count;
+    size_t capacity;
+} Array;
+
+void *array_push(Array *a, size_t item_size) {
+    if (a->count >= a->capacity) {
+        a->capacity = a->capacity == 0 ? 1024 : 2*a->capacity;
+        a->items = realloc(a->items, a->capacity*item_size);
+        assert(a->items != NULL);
+    }
+    void *item = (char *) a->items + a->count*item_size;
+    memset(item, 0, item_size);
+    a->count++;
+    return item;
+}
+
+int write_index(const char *src_file_name, const char *index_file_name) {
+    static Input in;
+    in.file = fopen(src_file_name, "rb");
+    if (in.file == NULL) {
+        printf("[ERROR] Could not open file '%s': %s\n", src_file_name, strerror(errno));
+        return 1;
+    }
+    libexample_parser_t parser;
+    libexample_init(&parser);
+    // only the headers of the blocks are needed, the payloads are skipped
+    parser.skip_binary = true;
+
+    Array clusters = {0};
+    Array blocks = {0};
+    // a Segment without TimestampScale has the one of the schema
+    libexample_default_t timestamp_scale_default;
+    if (!libexample_default(ID_TIMESTAMP_SCALE, &timestamp_scale_default)) UNREACHABLE("TimestampScale has no default");
+    uint64_t timestamp_scale = timestamp_scale_default.value;
+    uint64_t last_id = 0;
+    size_t group_block = SIDECAR_NONE;
+    while (input_fill(&in, 1) > 0) {
+        size_t consumed;
+        libexample_return_t r = libexample_parse_buffer(&parser, in.data + in.start, in.end - in.start, &consumed);
+        in.start += consumed;
+        switch (r) {
+            case LIBEXAMPLE_ERR:
+                printf("[ERROR] got error from library\n");
+                libexample_print(&parser);
+                fclose(in.file);
+                return 1;
+            case LIBEXAMPLE_OK:
+                break;
+            case LIBEXAMPLE_ELEMSTART:
+            case LIBEXAMPLE_SKIP: {
+                libexample_element_t elem;
+                libexample_current(&parser, &elem);
+                last_id = parser.id;
+                if (parser.id == ID_CLUSTER) {
+                    Sidecar_Cluster *c = array_push(&clusters, sizeof(Sidecar_Cluster));
+                    c->offset = elem.header_offset;
+                    c->first_block = blocks.count;
+                } else if (parser.id == ID_BLOCK_GROUP) {
+                    group_block = SIDECAR_NONE;
+                } else if (parser.id == ID_REFERENCE_BLOCK && group_block != SIDECAR_NONE) {
+                    // a Block that references others is no keyframe
+                    ((Sidecar_Block *) blocks.items)[group_block].flags &= ~SIDECAR_KEYFRAME;
+                } else if ((parser.id == ID_SIMPLE_BLOCK || parser.id == ID_BLOCK) && clusters.count > 0) {
+                    uint64_t size = elem.body_length;
+                    libexample_byte_t header[BLOCK_HEADER_MAX];
+                    size_t n = 0;
+                    // the first byte of the body has already been consumed
+                    header[n++] = in.data[in.start - 1];
+                    if (r == LIBEXAMPLE_SKIP) {
+                        size_t want = size - 1 < BLOCK_HEADER_MAX - 1 ? size - 1 : BLOCK_HEADER_MAX - 1;
+                        size_t have = input_fill(&in, want);
+                        if (have > want) have = want;
+                        memcpy(header + n, in.data + in.start, have);
+                        n += have;
+                    }
+                    // only the header, the payload offset and length include the lacing
+                    libexample_block_t block;
+                    if (libexample_block_decode(header, n, &block, NULL, 0) != LIBEXAMPLE_OK || block.header_length > size) {
+                        printf("[ERROR] malformed block header at offset %zu\n", elem.body_offset);
+                        fclose(in.file);
+                        return 1;
+                    }
+                    if (size - block.header_length > UINT32_MAX) {
+                        printf("[ERROR] payload of the block at offset %zu does not fit in the index\n", elem.body_offset);
+                        fclose(in.file);
+                        return 1;
+                    }
+                    Sidecar_Block *b = array_push(&blocks, sizeof(Sidecar_Block));
+                    b->payload_offset = elem.body_offset + block.header_length;
+                    b->payload_length = size - block.header_length;
+                    b->track = block.track;
+                    b->relative_timestamp = block.timecode;
+                    if (parser.id == ID_SIMPLE_BLOCK) {
+                        if (block.flags & 0x80) b->flags |= SIDECAR_KEYFRAME;
+                    } else {
+                        b->flags |= SIDECAR_KEYFRAME;
+                        group_block = blocks.count - 1;
+                    }
+                }
+                if (r == LIBEXAMPLE_SKIP) {
+                    if (!input_skip(&in, parser.skip_bytes)) {
+                        printf("[ERROR] Could not seek in file '%s': %s\n", src_file_name, strerror(errno));
+                        fclose(in.file);
+                        return 1;
+                    }
+                    libexample_skip(&parser);
+                }
+                break;
+            }
+            case LIBEXAMPLE_ELEMEND:
+                if (last_id == ID_TIMESTAMP_SCALE) {
+                    timestamp_scale = parser.value;
+                } else if (last_id == ID_TIMESTAMP && clusters.count > 0) {
+                    ((Sidecar_Cluster *) clusters.items)[clusters.count - 1].timestamp = parser.value;
+                }
+                last_id = 0;
+                break;
+        }
+    }
+    fclose(in.file);
+
+    Sidecar_Header header = {
+        .magic           = SIDECAR_MAGIC,
+        .version         = SIDECAR_VERSION,
+        .byte_order      = SIDECAR_BYTE_ORDER,
+        .timestamp_scale = timestamp_scale,
+        .cluster_count   = clusters.count,
+        .block_count     = blocks.count,
+        .cluster_table   = sizeof(Sidecar_Header),
+        .block_table     = sizeof(Sidecar_Header) + clusters.count*sizeof(Sidecar_Cluster),
+    };
+    FILE *index_file = fopen(index_file_name, "wb");
+    if (index_file == NULL) {
+        printf("[ERROR] Could not open file '%s': %s\n", index_file_name, strerror(errno));
+        return 1;
+    }
+    fwrite(&header, sizeof(header), 1, index_file);
+    fwrite(clusters.items, sizeof(Sidecar_Cluster), clusters.count, index_file);
+    fwrite(blocks.items, sizeof(Sidecar_Block), blocks.count, index_file);
+    if (fclose(index_file) != 0) {
+        printf("[ERROR] Could not write file '%s': %s\n", index_file_name, strerror(errno));
+        return 1;
+    }
+    printf("[INFO] indexed %zu clusters and %zu blocks\n", clusters.count, blocks.count);
+    free(clusters.items);
+    free(blocks.items);
+    return 0;
+}
+
+double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+int find(const char *index_file_name, uint32_t track, uint64_t timestamp_ns) {
+    Sidecar s;
+    double start = now();
+    if (!sidecar_open(&s, index_file_name)) {
+        printf("[ERROR] Could not open index '%s'\n", index_file_name);
+        return 1;
+    }
+    size_t c = sidecar_find_cluster(&s, timestamp_ns);
+    size_t k = sidecar_find_keyframe(&s, track, timestamp_ns);
+    double seconds = now() - start;
+    if (c == SIDECAR_NONE || k == SIDECAR_NONE) {
+        printf("[INFO] nothing at or before %lu ns\n", timestamp_ns);
+    } else {
+        printf("[INFO] cluster %zu at offset %lu, timestamp %lu\n", c, s.clusters[c].offset, s.clusters[c].timestamp);
+        printf("[INFO] keyframe %zu of track %u, payload at offset %lu, %u bytes\n", k, s.blocks[k].track, s.blocks[k].payload_offset, s.blocks[k].payload_length);
+    }
+    printf("[INFO] open and search took %.1f us\n", seconds*1e6);
+    sidecar_close(&s);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 3) return write_index(argv[1], argv[2]);
+    if (argc == 5 && strcmp(argv[1], "find") == 0) return find(argv[2], atoi(argv[3]), strtoull(argv[4], NULL, 10));
+    printf("Usage: %s <filename> <index>\n", argv[0]);
+    printf("       %s find <index> <track> <timestamp_ns>\n", argv[0]);
+    return 0;
+}
@@ -0,0 +1,159 @@
+#ifndef SIDECAR_H
+#define SIDECAR_H
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// The sidecar index of a media file. All records have a fixed width, so the file can be mapped
+// and searched in place. Everything is stored in the byte order of the machine that wrote it,
+// `sidecar_open` refuses files written with a different one.
+//
+// file layout:
+//     Sidecar_Header
+//     Sidecar_Cluster[cluster_count]   in file order, which is the order of their timestamps
+//     Sidecar_Block[block_count]       in file order, the blocks of a Cluster are next to each other
+
+#define SIDECAR_MAGIC "EBMLIDX"
+#define SIDECAR_VERSION 1
+#define SIDECAR_BYTE_ORDER 0x01020304
+#define SIDECAR_NONE SIZE_MAX
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t timestamp_scale;
+    uint64_t cluster_count;
+    uint64_t block_count;
+    uint64_t cluster_table;
+    uint64_t block_table;
+} Sidecar_Header;
+
+typedef struct {
+    uint64_t offset;       // of the Cluster header in the media file
+    uint64_t timestamp;    // in units of timestamp_scale ns
+    uint64_t first_block;  // index into the block table, never less than the one of the Cluster before
+} Sidecar_Cluster;
+
+#define SIDECAR_KEYFRAME 1
+
+typedef struct {
+    uint64_t payload_offset;  // of the frame data behind the block header in the media file
+    uint32_t payload_length;
+    uint32_t track;
+    int16_t relative_timestamp;
+    uint8_t flags;
+    uint8_t reserved[5];
+} Sidecar_Block;
+
+static_assert(sizeof(Sidecar_Header)  == 56, "Sidecar_Header is part of the file format");
+static_assert(sizeof(Sidecar_Cluster) == 24, "Sidecar_Cluster is part of the file format");
+static_assert(sizeof(Sidecar_Block)   == 24, "Sidecar_Block is part of the file format");
+
+typedef struct {
+    const uint8_t *data;
+    size_t length;
+    const Sidecar_Header *header;
+    const Sidecar_Cluster *clusters;
+    const Sidecar_Block *blocks;
+} Sidecar;
+
+bool sidecar_open(Sidecar *s, const char *path);
+void sidecar_close(Sidecar *s);
+size_t sidecar_find_cluster(const Sidecar *s, uint64_t timestamp_ns);
+size_t sidecar_find_keyframe(const Sidecar *s, uint32_t track, uint64_t timestamp_ns);
+
+#endif // SIDECAR_H
+
+#ifdef SIDECAR_IMPLEMENTATION
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+bool sidecar_open(Sidecar *s, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(Sidecar_Header)) {
+        close(fd);
+        return false;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+    s->data   = data;
+    s->length = st.st_size;
+    s->header = data;
+    const Sidecar_Header *h = s->header;
+    bool valid = memcmp(h->magic, SIDECAR_MAGIC, sizeof(h->magic)) == 0
+              && h->version == SIDECAR_VERSION
+              && h->byte_order == SIDECAR_BYTE_ORDER
+              && h->timestamp_scale != 0
+              && h->cluster_table <= s->length && h->cluster_count <= (s->length - h->cluster_table) / sizeof(Sidecar_Cluster)
+              && h->block_table <= s->length && h->block_count <= (s->length - h->block_table) / sizeof(Sidecar_Block);
+    if (!valid) {
+        sidecar_close(s);
+        return false;
+    }
+    s->clusters = (const Sidecar_Cluster *) (s->data + h->cluster_table);
+    s->blocks   = (const Sidecar_Block *) (s->data + h->block_table);
+    // the blocks of a Cluster run up to the first block of the next one, these ranges must stay in the block table
+    uint64_t first_block = 0;
+    for (size_t c=0; valid && c<h->cluster_count; c++) {
+        valid = s->clusters[c].first_block >= first_block && s->clusters[c].first_block <= h->block_count;
+        first_block = s->clusters[c].first_block;
+    }
+    if (!valid) {
+        sidecar_close(s);
+        return false;
+    }
+    return true;
+}
+
+void sidecar_close(Sidecar *s) {
+    munmap((void *) s->data, s->length);
+    s->data = NULL;
+    s->length = 0;
+}
+
+// the last Cluster that starts at or before the timestamp
+size_t sidecar_find_cluster(const Sidecar *s, uint64_t timestamp_ns) {
+    uint64_t timestamp = timestamp_ns / s->header->timestamp_scale;
+    size_t lo = 0;
+    size_t hi = s->header->cluster_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo)/2;
+        if (s->clusters[mid].timestamp <= timestamp) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo == 0 ? SIDECAR_NONE : lo - 1;
+}
+
+// the last keyframe of the track at or before the timestamp, 0 matches every track
+size_t sidecar_find_keyframe(const Sidecar *s, uint32_t track, uint64_t timestamp_ns) {
+    uint64_t timestamp = timestamp_ns / s->header->timestamp_scale;
+    size_t c = sidecar_find_cluster(s, timestamp_ns);
+    if (c == SIDECAR_NONE) return SIDECAR_NONE;
+    for (c++; c-- > 0;) {
+        size_t first = s->clusters[c].first_block;
+        size_t end = c + 1 < s->header->cluster_count ? s->clusters[c + 1].first_block : s->header->block_count;
+        for (size_t i=end; i-- > first;) {
+            const Sidecar_Block *b = &s->blocks[i];
+            int64_t t = (int64_t) s->clusters[c].timestamp + b->relative_timestamp;
+            if (t > (int64_t) timestamp) continue;
+            if (track != 0 && b->track != track) continue;
+            if (b->flags & SIDECAR_KEYFRAME) return i;
+        }
+    }
+    return SIDECAR_NONE;
+}
+
+#endif // SIDECAR_IMPLEMENTATION
@@ -0,0 +1,359 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "devutils.h"
+
+// Builds synthetic streams in memory for build/bench and build/library_test, and writes or compares the elements
+// of a stream through the generated library, so it has to be included after build/libexample.h (or one of its variants).
+
+// the numbers in the Info and the TrackEntry of the synthetic stream
+#define STREAM_DURATION 1234.5
+#define STREAM_DATE 700000000000000000
+#define STREAM_TRACK_TIMESTAMP_SCALE 1.5f
+#define STREAM_TRACK_OFFSET -300
+
+typedef struct {
+    uint8_t *data;
+    size_t count;
+    size_t capacity;
+} Buffer;
+
+void buffer_push(Buffer *b, uint8_t x) {
+    if (b->count >= b->capacity) {
+        b->capacity = b->capacity == 0 ? 1024 : 2*b->capacity;
+        b->data = realloc(b->data, b->capacity);
+        assert(b->data != NULL);
+    }
+    b->data[b->count] = x;
+    b->count++;
+}
+
+void put_id(Buffer *b, uint64_t id) {
+    int n = 1;
+    while (n < 4 && (id >> (8*n)) != 0) n++;
+    for (int i=n-1; i>=0; i--) buffer_push(b, (id >> (8*i)) & 0xFF);
+}
+
+void put_size(Buffer *b, uint64_t size, int width) {
+    uint64_t marked = size | ((uint64_t) 1 << (7*width));
+    for (int i=width-1; i>=0; i--) buffer_push(b, (marked >> (8*i)) & 0xFF);
+}
+
+// writes an eight byte placeholder for the size and returns its position
+size_t begin_master(Buffer *b, uint64_t id) {
+    put_id(b, id);
+    size_t at = b->count;
+    put_size(b, 0, 8);
+    return at;
+}
+
+void end_master(Buffer *b, size_t at) {
+    uint64_t size = b->count - at - 8;
+    size_t count = b->count;
+    b->count = at;
+    put_size(b, size, 8);
+    b->count = count;
+}
+
+void put_uint(Buffer *b, uint64_t id, uint64_t value) {
+    int n = 1;
+    while (n < 8 && (value >> (8*n)) != 0) n++;
+    put_id(b, id);
+    put_size(b, n, 1);
+    for (int i=n-1; i>=0; i--) buffer_push(b, (value >> (8*i)) & 0xFF);
+}
+
+void put_string(Buffer *b, uint64_t id, const char *s) {
+    size_t n = strlen(s);
+    put_id(b, id);
+    put_size(b, n, 1);
+    for (size_t i=0; i<n; i++) buffer_push(b, s[i]);
+}
+
+// the lowest `n` bytes of `bits`, for fixed width numbers
+void put_fixed(Buffer *b, uint64_t id, uint64_t bits, int n) {
+    put_id(b, id);
+    put_size(b, n, 1);
+    for (int i=n-1; i>=0; i--) buffer_push(b, (bits >> (8*i)) & 0xFF);
+}
+
+void put_fixed_uint(Buffer *b, uint64_t id, uint64_t value) {
+    put_fixed(b, id, value, 8);
+}
+
+void put_double(Buffer *b, uint64_t id, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, 8);
+    put_fixed(b, id, bits, 8);
+}
+
+void put_float(Buffer *b, uint64_t id, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+    put_fixed(b, id, bits, 4);
+}
+
+void patch_fixed_uint(Buffer *b, size_t at, uint64_t value) {
+    for (int i=7; i>=0; i--) b->data[at + 7 - i] = (value >> (8*i)) & 0xFF;
+}
+
+// a SimpleBlock of track 1 with a random payload
+void put_simple_block(Buffer *b, int16_t timestamp, bool keyframe, size_t n, uint32_t *seed) {
+    put_id(b, 0xA3);
+    put_size(b, n + 4, n + 4 < 127 ? 1 : (n + 4 < 16383 ? 2 : 4));
+    buffer_push(b, 0x81);
+    buffer_push(b, (timestamp >> 8) & 0xFF);
+    buffer_push(b, timestamp & 0xFF);
+    buffer_push(b, keyframe ? 0x80 : 0x00);
+    for (size_t i=0; i<n; i++) {
+        *seed = *seed * 1103515245 + 12345;
+        buffer_push(b, *seed >> 24);
+    }
+}
+
+// a Seek entry whose position is patched in later, returns where the position goes
+size_t put_seek(Buffer *b, uint64_t id) {
+    size_t seek = begin_master(b, 0x4DBB);
+    // SeekID is binary, but its bytes are the same as those of the id as an uint
+    put_uint(b, 0x53AB, id);
+    put_fixed_uint(b, 0x53AC, 0);
+    end_master(b, seek);
+    return b->count - 8;
+}
+
+// a minimal matroska like stream: header, seek head, info, one track, clusters full of SimpleBlocks and cues
+Buffer make_stream(size_t target_size) {
+    Buffer b = {0};
+    uint32_t seed = 1;
+    size_t ebml = begin_master(&b, 0x1A45DFA3);
+    put_uint(&b, 0x4286, 1);
+    put_string(&b, 0x4282, "matroska");
+    end_master(&b, ebml);
+    size_t segment = begin_master(&b, 0x18538067);
+    size_t segment_body = b.count;
+    size_t seek_head = begin_master(&b, 0x114D9B74);
+    size_t info_position = put_seek(&b, 0x1549A966);
+    size_t cues_position = put_seek(&b, 0x1C53BB6B);
+    end_master(&b, seek_head);
+    patch_fixed_uint(&b, info_position, b.count - segment_body);
+    size_t info = begin_master(&b, 0x1549A966);
+    put_uint(&b, 0x2AD7B1, 1000000);
+    put_double(&b, 0x4489, STREAM_DURATION);
+    put_fixed(&b, 0x4461, STREAM_DATE, 8);
+    end_master(&b, info);
+    size_t tracks = begin_master(&b, 0x1654AE6B);
+    size_t entry = begin_master(&b, 0xAE);
+    put_uint(&b, 0xD7, 1);
+    put_string(&b, 0x86, "V_UNCOMPRESSED");
+    put_float(&b, 0x23314F, STREAM_TRACK_TIMESTAMP_SCALE);
+    put_fixed(&b, 0x537F, STREAM_TRACK_OFFSET, 2);
+    end_master(&b, entry);
+    end_master(&b, tracks);
+    Buffer cues = {0};
+    for (uint64_t t=0; b.count < target_size; t++) {
+        size_t point = begin_master(&cues, 0xBB);
+        put_uint(&cues, 0xB3, t*1000);
+        size_t positions = begin_master(&cues, 0xB7);
+        put_uint(&cues, 0xF7, 1);
+        put_uint(&cues, 0xF1, b.count - segment_body);
+        end_master(&cues, positions);
+        end_master(&cues, point);
+        size_t cluster = begin_master(&b, 0x1F43B675);
+        put_uint(&b, 0xE7, t*1000);
+        for (size_t i=0; i<32; i++) {
+            seed = seed * 1103515245 + 12345;
+            put_simple_block(&b, i*32, i % 8 == 0, 60 + (seed >> 16) % 4096, &seed);
+        }
+        end_master(&b, cluster);
+    }
+    patch_fixed_uint(&b, cues_position, b.count - segment_body);
+    size_t cue_list = begin_master(&b, 0x1C53BB6B);
+    for (size_t i=0; i<cues.count; i++) buffer_push(&b, cues.data[i]);
+    end_master(&b, cue_list);
+    free(cues.data);
+    end_master(&b, segment);
+    return b;
+}
+
+// a copy of the stream as a live encoder writes it: the Segment and the Clusters have an unknown size
+Buffer make_live(Buffer b) {
+    Buffer live = {0};
+    for (size_t i=0; i<b.count; i++) buffer_push(&live, b.data[i]);
+    libexample_cursor_t cur;
+    libexample_cursor_init(&cur, b.data, b.count);
+    libexample_element_t elem;
+    while (libexample_next(&cur, &elem) == LIBEXAMPLE_ELEMSTART) {
+        if (elem.id != 0x18538067 && elem.id != 0x1F43B675) continue;
+        size_t count = live.count;
+        live.count = elem.body_offset - 8;
+        put_size(&live, ((uint64_t) 1 << 56) - 1, 8);
+        live.count = count;
+    }
+    return live;
+}
+
+// the smallest width for a vint with `value`, the value with all bits set is reserved
+int vint_width(uint64_t value) {
+    int width = 1;
+    while (value >= ((uint64_t) 1 << (7*width)) - 1) width++;
+    return width;
+}
+
+// the body of a block of an audio track with `count` frames of random sizes, the sizes go to `sizes`
+void put_laced_block(Buffer *b, int lacing, size_t count, size_t *sizes, uint32_t *seed) {
+    buffer_push(b, 0x82);
+    buffer_push(b, 0);
+    buffer_push(b, 0);
+    buffer_push(b, 0x80 | (lacing << 1));
+    for (size_t i=0; i<count; i++) {
+        *seed = *seed * 1103515245 + 12345;
+        sizes[i] = lacing == LIBEXAMPLE_LACING_FIXED && i > 0 ? sizes[0] : 1 + (*seed >> 16) % 600;
+    }
+    if (lacing != LIBEXAMPLE_LACING_NONE) buffer_push(b, count - 1);
+    for (size_t i=0; i+1<count; i++) {
+        if (lacing == LIBEXAMPLE_LACING_XIPH) {
+            size_t n = sizes[i];
+            for (; n >= 255; n -= 255) buffer_push(b, 255);
+            buffer_push(b, n);
+        } else if (lacing == LIBEXAMPLE_LACING_EBML && i == 0) {
+            put_size(b, sizes[0], vint_width(sizes[0]));
+        } else if (lacing == LIBEXAMPLE_LACING_EBML) {
+            int64_t delta = (int64_t) sizes[i] - (int64_t) sizes[i-1];
+            int width = 1;
+            while (delta < -((((int64_t) 1) << (7*width - 1)) - 1) || delta > (((int64_t) 1) << (7*width - 1)) - 1) width++;
+            put_size(b, delta + (((int64_t) 1) << (7*width - 1)) - 1, width);
+        }
+    }
+    for (size_t i=0; i<count; i++) {
+        for (size_t j=0; j<sizes[i]; j++) buffer_push(b, j);
+    }
+}
+
+// writes every element of `b` again, returns the number of elements
+size_t remux(Buffer b, libexample_writer_t *w) {
+    libexample_cursor_t cur;
+    libexample_cursor_init(&cur, b.data, b.count);
+    libexample_element_t elem;
+    size_t elements = 0;
+    libexample_return_t r;
+    while ((r = libexample_next(&cur, &elem)) == LIBEXAMPLE_ELEMSTART) {
+        while (w->depth >= elem.depth) {
+            if (libexample_end_master(w) != LIBEXAMPLE_OK) UNREACHABLE("remux: end_master");
+        }
+        switch (elem.type) {
+            case LIBEXAMPLE_TYPE_MASTER:
+                r = libexample_begin_master(w, elem.id);
+                break;
+            case LIBEXAMPLE_TYPE_UINTEGER:
+                r = libexample_write_uint(w, elem.id, read_uint(elem.body, elem.body_length));
+                break;
+            case LIBEXAMPLE_TYPE_INTEGER:
+            case LIBEXAMPLE_TYPE_DATE:
+                r = libexample_write_int(w, elem.id, read_int(elem.body, elem.body_length));
+                break;
+            case LIBEXAMPLE_TYPE_FLOAT:
+                r = libexample_write_float(w, elem.id, read_float(elem.body, elem.body_length));
+                break;
+            case LIBEXAMPLE_TYPE_STRING:
+            case LIBEXAMPLE_TYPE_UTF_8:
+                r = libexample_write_string(w, elem.id, (const char *) elem.body, elem.body_length);
+                break;
+            default:
+                r = libexample_write_binary(w, elem.id, elem.body, elem.body_length);
+        }
+        if (r != LIBEXAMPLE_OK) UNREACHABLE("remux: write error");
+        elements++;
+    }
+    if (r != LIBEXAMPLE_OK) UNREACHABLE("remux: parse error");
+    while (w->depth > 0) {
+        if (libexample_end_master(w) != LIBEXAMPLE_OK) UNREACHABLE("remux: end_master");
+    }
+    if (libexample_writer_flush(w) != LIBEXAMPLE_OK) UNREACHABLE("remux: flush");
+    return elements;
+}
+
+// the same elements with the same values, only the widths of the numbers and sizes may differ
+bool same_elements(Buffer a, Buffer b) {
+    libexample_cursor_t ca, cb;
+    libexample_cursor_init(&ca, a.data, a.count);
+    libexample_cursor_init(&cb, b.data, b.count);
+    libexample_element_t ea, eb;
+    for (;;) {
+        libexample_return_t ra = libexample_next(&ca, &ea);
+        libexample_return_t rb = libexample_next(&cb, &eb);
+        if (ra != rb || ra == LIBEXAMPLE_ERR) return false;
+        if (ra == LIBEXAMPLE_OK) return true;
+        if (ea.id != eb.id || ea.depth != eb.depth) return false;
+        switch (ea.type) {
+            case LIBEXAMPLE_TYPE_MASTER:
+                break;
+            case LIBEXAMPLE_TYPE_UINTEGER:
+                if (read_uint(ea.body, ea.body_length) != read_uint(eb.body, eb.body_length)) return false;
+                break;
+            case LIBEXAMPLE_TYPE_INTEGER:
+            case LIBEXAMPLE_TYPE_DATE:
+                if (read_int(ea.body, ea.body_length) != read_int(eb.body, eb.body_length)) return false;
+                break;
+            case LIBEXAMPLE_TYPE_FLOAT:
+                if (read_float(ea.body, ea.body_length) != read_float(eb.body, eb.body_length)) return false;
+                break;
+            default:
+                if (ea.body_length != eb.body_length || memcmp(ea.body, eb.body, ea.body_length) != 0) return false;
+        }
+    }
+}
+
+size_t count_children(const libexample_byte_t *data, size_t length) {
+    libexample_cursor_t cur;
+    libexample_cursor_init(&cur, data, length);
+    libexample_element_t elem;
+    size_t count = 0;
+    while (libexample_next(&cur, &elem) == LIBEXAMPLE_ELEMSTART) {
+        if (elem.depth == 1) count++;
+    }
+    return count;
+}
+
+// the elements of `data` as nodes in `first`, the children of master elements are taken from `pool`
+void build_nodes(libexample_node_t *first, libexample_node_t *pool, size_t *used, const libexample_byte_t *data, size_t length) {
+    libexample_cursor_t cur;
+    libexample_cursor_init(&cur, data, length);
+    libexample_element_t elem;
+    libexample_node_t *n = first;
+    while (libexample_next(&cur, &elem) == LIBEXAMPLE_ELEMSTART) {
+        if (elem.depth != 1) continue;
+        memset(n, 0, sizeof(*n));
+        n->id = elem.id;
+        switch (elem.type) {
+            case LIBEXAMPLE_TYPE_MASTER:
+                n->child_count = count_children(elem.body, elem.body_length);
+                n->children = pool + *used;
+                *used += n->child_count;
+                build_nodes(n->children, pool, used, elem.body, elem.body_length);
+                break;
+            case LIBEXAMPLE_TYPE_UINTEGER:
+                n->value = read_uint(elem.body, elem.body_length);
+                break;
+            case LIBEXAMPLE_TYPE_INTEGER:
+            case LIBEXAMPLE_TYPE_DATE:
+                n->int_value = read_int(elem.body, elem.body_length);
+                break;
+            case LIBEXAMPLE_TYPE_FLOAT:
+                n->float_value = read_float(elem.body, elem.body_length);
+                break;
+            default:
+                n->data = elem.body;
+                n->length = elem.body_length;
+        }
+        n++;
+    }
+}
+
+#endif // STREAM_H
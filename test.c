@@ -5,15 +5,32 @@
 #include "devutils.h"
 
 #define LIBEXAMPLE_IMPLEMENTATION
+#if defined(TEST_LEAN)
+#include "build/libexample_lean.h"
+#elif defined(TEST_MULTI)
+#include "build/libexample_multi.h"
+#else
 #include "build/libexample.h"
+#endif
+
+#ifdef LIBEXAMPLE_VALIDATE
+void print_violation(void *user, libexample_violation_t violation, uint64_t id, const char *name, uint64_t offset) {
+    UNUSED(user);
+    const char *what[LIBEXAMPLE_VIOLATION_COUNT] = {"out of range", "of the wrong length", "missing", "repeated", "misplaced"};
+    printf("[INFO] %s (0x%lX) at offset %lu is %s\n", name, id, offset, what[violation]);
+}
+#endif
 
 int main(int argc, char **argv) {
     char *src_file_name;
-    if (argc < 2) {
-        printf("Usage: %s <filename>\n", argv[0]);
+    // --skip-binary seeks over binary payloads instead of reading them
+    bool skip_binary = argc > 1 && strcmp(argv[1], "--skip-binary") == 0;
+    int first_arg = skip_binary ? 2 : 1;
+    if (argc < first_arg + 1) {
+        printf("Usage: %s [--skip-binary] <filename> [path...]\n", argv[0]);
         exit(0);
     } else {
-        src_file_name = argv[1];
+        src_file_name = argv[first_arg];
     }
 
     FILE *src_file = fopen(src_file_name, "rb");
@@ -24,8 +41,42 @@ int main(int argc, char **argv) {
 
     libexample_parser_t parser;
     libexample_init(&parser);
+    parser.skip_binary = skip_binary;
+    // a lean parser collects the values into a buffer of ours, the default one into itself
+#ifdef LIBEXAMPLE_LEAN
+    libexample_values_t values_buffer;
+    parser.values = &values_buffer;
+    libexample_values_t *values = parser.values;
+#else
+    libexample_parser_t *values = &parser;
+#endif
+#ifdef LIBEXAMPLE_STATS
+    // too large for the stack of some platforms
+    static libexample_stats_t stats;
+    parser.stats = &stats;
+#endif
+#ifdef LIBEXAMPLE_VALIDATE
+    libexample_validation_t validation = {.on_violation = print_violation};
+    parser.validation = &validation;
+#endif
+
+    // any further arguments are element paths like \\Segment\\Info, everything else gets skipped
+    libexample_filter_t filter;
+    if (argc > first_arg + 1) {
+        libexample_filter_init(&filter);
+        for (int i=first_arg+1; i<argc; i++) {
+            if (!libexample_filter_add(&filter, argv[i])) {
+                printf("[ERROR] Unknown element path '%s'\n", argv[i]);
+                fclose(src_file);
+                exit(1);
+            }
+        }
+        parser.filter = &filter;
+    }
 
-    size_t cur_type;
+    libexample_element_t elem = {0};
+    bool skipped = false;
+    uint64_t skipped_bytes = 0;
 
     bool collect_utf8;
     char *utf8_buffer;
@@ -49,52 +100,76 @@ int main(int argc, char **argv) {
                     utf8_buffer_count++;
                 }
                 break;
+            case LIBEXAMPLE_SKIP:
             case LIBEXAMPLE_ELEMSTART:
                 //printf("\n");
-                cur_type = parser.type;
+                libexample_current(&parser, &elem);
                 printf("[INFO] ");
-                for (size_t i=0; i<parser.this_depth-1; i++) printf("|");
-                printf("+--%zu--%s--0x%lX--%s--%lu--\n", parser.this_depth, parser.name, parser.id[parser.this_depth], type_as_string[parser.type], parser.size[parser.this_depth]);
-                if (cur_type == 3) { // utf-8
+                for (size_t i=0; i<elem.depth-1; i++) printf("|");
+                printf("+--%zu--%s--0x%lX--%s--%lu--\n", elem.depth, elem.name, elem.id, type_as_string[elem.type], elem.body_length);
+                if (elem.type == LIBEXAMPLE_TYPE_UTF_8 && r != LIBEXAMPLE_SKIP) {
                     collect_utf8 = true;
-                    utf8_buffer = malloc(parser.size[parser.this_depth] + 1);
+                    utf8_buffer = malloc(elem.body_length + 1);
                     utf8_buffer[0] = c;
-                    utf8_buffer[parser.size[parser.this_depth]] = '\0';
+                    utf8_buffer[elem.body_length] = '\0';
                     utf8_buffer_count = 1;
                 }
+                if (r == LIBEXAMPLE_SKIP) {
+                    if (fseek(src_file, parser.skip_bytes, SEEK_CUR) != 0) {
+                        printf("[ERROR] Could not seek in file '%s': %s\n", src_file_name, strerror(errno));
+                        fclose(src_file);
+                        exit(1);
+                    }
+                    skipped_bytes += parser.skip_bytes;
+                    libexample_skip(&parser);
+                    skipped = true;
+                }
                 //printf("0x%02X ", c);
                 break;
             case LIBEXAMPLE_ELEMEND:
                 //printf("\n");
-                switch (cur_type) {
-                    case 1: //uinteger
+                if (skipped) {
+                    // we never saw the body, so there is no value to print
+                    skipped = false;
+                    break;
+                }
+                switch (elem.type) {
+                    case LIBEXAMPLE_TYPE_UINTEGER:
                         printf("[INFO] ");
-                        for (size_t i=0; i<parser.this_depth; i++) printf("|");
-                        printf("%lu\n", parser.value);
+                        for (size_t i=0; i<elem.depth; i++) printf("|");
+                        printf("%lu\n", values->value);
                         break;
-                    case 4: //string
+                    case LIBEXAMPLE_TYPE_STRING:
                         printf("[INFO] ");
-                        for (size_t i=0; i<parser.this_depth; i++) printf("|");
-                        printf("%s\n", parser.string_buffer);
+                        for (size_t i=0; i<elem.depth; i++) printf("|");
+                        printf("%s\n", values->string_buffer);
                         break;
-                    case 6: //binary
+                    case LIBEXAMPLE_TYPE_BINARY:
                         break;
-                    case 3: //utf-8
+                    case LIBEXAMPLE_TYPE_UTF_8:
                         assert(collect_utf8);
                         printf("[INFO] ");
-                        for (size_t i=0; i<parser.this_depth; i++) printf("|");
+                        for (size_t i=0; i<elem.depth; i++) printf("|");
                         printf("%s\n", utf8_buffer);
                         UNUSED(utf8_buffer_count);
                         collect_utf8 = false;
                         free(utf8_buffer);
                         break;
-                    case 7: //float
-                        //TODO: print the float
+                    case LIBEXAMPLE_TYPE_INTEGER:
+                    case LIBEXAMPLE_TYPE_DATE:
+                        printf("[INFO] ");
+                        for (size_t i=0; i<elem.depth; i++) printf("|");
+                        printf("%ld\n", values->int_value);
+                        break;
+                    case LIBEXAMPLE_TYPE_FLOAT:
+                        printf("[INFO] ");
+                        for (size_t i=0; i<elem.depth; i++) printf("|");
+                        printf("%g\n", values->float_value);
                         break;
-                    case 0: //master
+                    case LIBEXAMPLE_TYPE_MASTER:
                         break;
                     default:
-                        printf("[ERROR] got type %zu (%s)\n", cur_type, type_as_string[cur_type]);
+                        printf("[ERROR] got type %zu (%s)\n", elem.type, type_as_string[elem.type]);
                         UNIMPLEMENTED("handling LIBEXAMPLE ELEMEND");
                 }
                 //printf("0x%02X ", c);
@@ -109,8 +184,19 @@ int main(int argc, char **argv) {
         case LIBEXAMPLE_OK:
         case LIBEXAMPLE_ELEMSTART:
         case LIBEXAMPLE_ELEMEND:
+        case LIBEXAMPLE_SKIP:
             break;
     }
+    if (parser.filter != NULL) printf("[INFO] skipped %lu bytes\n", skipped_bytes);
+#ifdef LIBEXAMPLE_DOCTYPE_COUNT
+    printf("[INFO] DocType %d\n", parser.doctype);
+#endif
+#ifdef LIBEXAMPLE_VALIDATE
+    printf("[INFO] %lu violations\n", validation.violations);
+#endif
+#ifdef LIBEXAMPLE_STATS
+    libexample_stats_dump(&stats, stdout);
+#endif
 
     fclose(src_file);
 }
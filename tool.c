@@ -5,6 +5,7 @@
 #include <stdbool.h>
 #include <stdarg.h>
 #include <ctype.h>
+#include <time.h>
 
 #include "devutils.h"
 #include "thirdparty/yxml.h"
@@ -14,13 +15,15 @@
 
 #define XML_PARSE_BUFSIZE 4069
 char xml_parse_buffer[XML_PARSE_BUFSIZE];
+// the schema is read in chunks of this size
+#define SCHEMA_READ_BUFSIZE (1 << 20)
 
 //=====================================================================
 /********************************************************************
  * I took this from https://github.com/tsoding/la/blob/master/lag.c *
  * Thank you to Tsoding!                                            *
  ********************************************************************/
-#define SHORT_STRING_LENGTH 128
+#define SHORT_STRING_LENGTH 256
 typedef struct {
     char cstr[SHORT_STRING_LENGTH];
 } Short_String;
@@ -50,6 +53,14 @@ Short_String append(Short_String str1, char *str2) {
     return shortf("%s%s", str1.cstr, str2);
 }
 
+// yxml hands out attribute values a few bytes at a time, so they are appended in place
+void append_in_place(Short_String *str, const char *data) {
+    size_t length = strlen(str->cstr);
+    size_t n = strlen(data);
+    assert(length + n + 1 <= sizeof(str->cstr));
+    memcpy(str->cstr + length, data, n + 1);
+}
+
 Short_String capitalize(Short_String str) {
     for (size_t i=0; i<SHORT_STRING_LENGTH; i++) {
         if (str.cstr[i] == '\0') {
@@ -71,6 +82,12 @@ typedef struct {
     Short_String id;
     Short_String type;
     Short_String range;
+    Short_String unknownsizeallowed;
+    Short_String recursive;
+    Short_String minoccurs;
+    Short_String maxoccurs;
+    Short_String length;
+    Short_String default_value;
 } Pre_EBML_Element;
 
 void init_pre_element(Pre_EBML_Element *elem) {
@@ -79,6 +96,12 @@ void init_pre_element(Pre_EBML_Element *elem) {
     elem->id.cstr[0]    = '\0';
     elem->type.cstr[0]  = '\0';
     elem->range.cstr[0] = '\0';
+    elem->unknownsizeallowed.cstr[0] = '\0';
+    elem->recursive.cstr[0] = '\0';
+    elem->minoccurs.cstr[0] = '\0';
+    elem->maxoccurs.cstr[0] = '\0';
+    elem->length.cstr[0] = '\0';
+    elem->default_value.cstr[0] = '\0';
 }
 
 void print_pre_element(Pre_EBML_Element elem) {
@@ -87,6 +110,12 @@ void print_pre_element(Pre_EBML_Element elem) {
     printf("[INFO]     id    = '%s'\n", elem.id.cstr);
     printf("[INFO]     type  = '%s'\n", elem.type.cstr);
     printf("[INFO]     range = '%s'\n", elem.range.cstr);
+    printf("[INFO]     unknownsizeallowed = '%s'\n", elem.unknownsizeallowed.cstr);
+    printf("[INFO]     recursive = '%s'\n", elem.recursive.cstr);
+    printf("[INFO]     minOccurs = '%s'\n", elem.minoccurs.cstr);
+    printf("[INFO]     maxOccurs = '%s'\n", elem.maxoccurs.cstr);
+    printf("[INFO]     length = '%s'\n", elem.length.cstr);
+    printf("[INFO]     default = '%s'\n", elem.default_value.cstr);
 }
 
 typedef enum {
@@ -150,8 +179,17 @@ typedef struct {
     uint64_t id;
     EBML_Type type;
     EBML_Range range;
+    bool unknown_size_allowed;
+    bool recursive;
+    uint32_t doctypes; // one bit per DocType that has the element
+    size_t min_occurs;
+    size_t max_occurs; // NO_MAX_OCCURS if it is not limited
+    EBML_Range length; // of the body
+    Short_String default_value;
 } EBML_Element;
 
+#define NO_MAX_OCCURS SIZE_MAX
+
 Pre_EBML_Element global_elements[] = {
     {
         .name = {"CRC-32"},
@@ -173,6 +211,8 @@ Pre_EBML_Element default_header[] = {
         .path = {"\\EBML"},
         .id   = {"0x1A45DFA3"},
         .type = {"master"},
+        .minoccurs = {"1"},
+        .maxoccurs = {"1"},
     },
     {
         .name  = {"EBMLVersion"},
@@ -180,6 +220,9 @@ Pre_EBML_Element default_header[] = {
         .id    = {"0x4286"},
         .type  = {"uinteger"},
         .range = {"not 0"},
+        .minoccurs = {"1"},
+        .maxoccurs = {"1"},
+        .default_value = {"1"},
     },
     {
         .name  = {"EBMLReadVersion"},
@@ -187,6 +230,9 @@ Pre_EBML_Element default_header[] = {
         .id    = {"0x42F7"},
         .range = {"1"},
         .type  = {"uinteger"},
+        .minoccurs = {"1"},
+        .maxoccurs = {"1"},
+        .default_value = {"1"},
     },
     {
         .name  = {"EBMLMaxIDLength"},
@@ -194,6 +240,9 @@ Pre_EBML_Element default_header[] = {
         .id    = {"0x42F2"},
         .range = {">=4"},
         .type  = {"uinteger"},
+        .minoccurs = {"1"},
+        .maxoccurs = {"1"},
+        .default_value = {"4"},
     },
     {
         .name  = {"EBMLMaxSizeLength"},
@@ -201,12 +250,17 @@ Pre_EBML_Element default_header[] = {
         .id    = {"0x42F3"},
         .range = {"not 0"},
         .type  = {"uinteger"},
+        .minoccurs = {"1"},
+        .maxoccurs = {"1"},
+        .default_value = {"8"},
     },
     {
         .name = {"DocType"},
         .path = {"\\EBML\\DocType"},
         .id   = {"0x4282"},
         .type = {"string"},
+        .minoccurs = {"1"},
+        .maxoccurs = {"1"},
     },
     {
         .name  = {"DocTypeVersion"},
@@ -214,6 +268,9 @@ Pre_EBML_Element default_header[] = {
         .id    = {"0x4287"},
         .range = {"not 0"},
         .type  = {"uinteger"},
+        .minoccurs = {"1"},
+        .maxoccurs = {"1"},
+        .default_value = {"1"},
     },
     {
         .name  = {"DocTypeReadVersion"},
@@ -221,6 +278,9 @@ Pre_EBML_Element default_header[] = {
         .id    = {"0x4285"},
         .range = {"not 0"},
         .type  = {"uinteger"},
+        .minoccurs = {"1"},
+        .maxoccurs = {"1"},
+        .default_value = {"1"},
     },
 /*
     {
@@ -278,9 +338,113 @@ Pre_EBML_Element default_header[] = {
 // */
 };
 
-#define MAX_ELEMENT_COUNT 512
-EBML_Element element_list[MAX_ELEMENT_COUNT];
+// Everything the generator allocates lives until it exits, so it comes from large blocks that are never freed.
+#define ARENA_BLOCK_SIZE (1 << 20)
+struct {
+    char *block;
+    size_t used;
+    size_t size;
+} arena = {0};
+
+// zeroed memory
+void *arena_alloc(size_t size) {
+    size = (size + 15) & ~(size_t) 15;
+    if (arena.block == NULL || arena.used + size > arena.size) {
+        arena.size  = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        arena.block = calloc(1, arena.size);
+        if (arena.block == NULL) UNIMPLEMENTED("arena_alloc: out of memory");
+        arena.used  = 0;
+    }
+    void *result = arena.block + arena.used;
+    arena.used += size;
+    return result;
+}
+
+// The per element tables grow together, the old ones stay behind in the arena.
+#define MIN_ELEMENT_CAPACITY 256
+EBML_Element *element_list = NULL;
 size_t element_count = 0;
+size_t element_capacity = 0;
+size_t *element_parent = NULL;
+size_t *element_slot = NULL;
+size_t *slot_element = NULL;
+uint32_t *hash_displacement = NULL;
+
+#define NO_ELEMENT SIZE_MAX
+
+// every schema is one DocType, the elements they define alike are only there once
+#define MAX_DOCTYPES 16
+#define NO_DOCTYPE SIZE_MAX
+#define ALL_DOCTYPES UINT32_MAX
+Short_String doctype_names[MAX_DOCTYPES];
+size_t doctype_count = 0;
+
+size_t find_doctype(const char *name) {
+    for (size_t t=0; t<doctype_count; t++) {
+        if (strcmp(doctype_names[t].cstr, name) == 0) return t;
+    }
+    if (doctype_count == MAX_DOCTYPES) {
+        printf("[ERROR] more than %d DocTypes\n", MAX_DOCTYPES);
+        exit(1);
+    }
+    doctype_names[doctype_count] = shortf("%s", name);
+    return doctype_count++;
+}
+
+bool multiple_doctypes(void) {
+    return doctype_count > 1;
+}
+
+// id -> index into element_list, open addressing with linear probing
+size_t *id_index = NULL;
+size_t id_index_size = 0;
+size_t id_index_used = 0;
+
+// the seed is spread over all bits, so that consecutive ids do not crowd into the same slots
+uint64_t hash_id(uint64_t id, uint64_t seed) {
+    uint64_t x = (id ^ (seed * 0xC2B2AE3D27D4EB4F)) * 0x9E3779B97F4A7C15;
+    return x ^ (x >> 32);
+}
+
+size_t find_id(uint64_t id) {
+    if (id_index_size == 0) return NO_ELEMENT;
+    for (size_t h = hash_id(id, 0) & (id_index_size - 1);; h = (h + 1) & (id_index_size - 1)) {
+        size_t e = id_index[h];
+        if (e == NO_ELEMENT) return NO_ELEMENT;
+        if (e < element_count && element_list[e].id == id) return e;
+    }
+}
+
+void index_id(size_t e) {
+    if (2*(id_index_used + 1) > id_index_size) {
+        id_index_size = 64;
+        while (id_index_size < 4*element_capacity) id_index_size *= 2;
+        id_index = arena_alloc(id_index_size * sizeof(*id_index));
+        for (size_t h=0; h<id_index_size; h++) id_index[h] = NO_ELEMENT;
+        id_index_used = 0;
+        for (size_t i=0; i<element_count; i++) {
+            if (i != e) index_id(i);
+        }
+    }
+    size_t h = hash_id(element_list[e].id, 0) & (id_index_size - 1);
+    while (id_index[h] != NO_ELEMENT) h = (h + 1) & (id_index_size - 1);
+    id_index[h] = e;
+    id_index_used++;
+}
+
+void reserve_elements(size_t count) {
+    if (count <= element_capacity) return;
+    size_t capacity = element_capacity < MIN_ELEMENT_CAPACITY ? MIN_ELEMENT_CAPACITY : element_capacity;
+    while (capacity < count) capacity *= 2;
+    EBML_Element *list = arena_alloc(capacity * sizeof(*list));
+    if (element_count > 0) memcpy(list, element_list, element_count * sizeof(*list));
+    element_list      = list;
+    element_parent    = arena_alloc(capacity * sizeof(*element_parent));
+    element_slot      = arena_alloc(capacity * sizeof(*element_slot));
+    slot_element      = arena_alloc(capacity * sizeof(*slot_element));
+    hash_displacement = arena_alloc(capacity * sizeof(*hash_displacement));
+    element_capacity  = capacity;
+}
 
 EBML_Range parse_range_exact(Short_String str) {
     EBML_Range result = {
@@ -710,26 +874,352 @@ EBML_Element process_element(Pre_EBML_Element elem) {
     }
     result.type = parse_type(elem.type);
     result.range = parse_range(elem.range);
+    result.unknown_size_allowed = strcmp(elem.unknownsizeallowed.cstr, "1") == 0;
+    result.recursive = strcmp(elem.recursive.cstr, "1") == 0 || (result.path.depth > 0 && result.path.recursive[result.path.depth - 1]);
+    // without minOccurs an element is optional, without maxOccurs it may be repeated as often as needed
+    result.min_occurs = strtoull(elem.minoccurs.cstr, NULL, 10);
+    result.max_occurs = elem.maxoccurs.cstr[0] == '\0' ? NO_MAX_OCCURS : strtoull(elem.maxoccurs.cstr, NULL, 10);
+    result.length = parse_range(elem.length);
+    result.default_value = elem.default_value;
     return result;
 }
 
 void append_element(EBML_Element elem) {
-    if (element_count >= MAX_ELEMENT_COUNT) {
-        UNIMPLEMENTED("element_list is full");
-    }
+    reserve_elements(element_count + 1);
     element_list[element_count] = elem;
     element_count++;
+    index_id(element_count - 1);
+}
+
+bool same_path(EBML_Path p1, EBML_Path p2) {
+    if (p1.depth != p2.depth) return false;
+    for (size_t i=0; i<p1.depth; i++) {
+        if (!equal(p1.names[i], p2.names[i])) return false;
+    }
+    return true;
 }
 
+// an element of another DocType is shared if both agree on what it is, the ids of different elements have to differ
 void insert_element(EBML_Element elem) {
+    size_t i = find_id(elem.id);
+    if (i == NO_ELEMENT) {
+        append_element(elem);
+        return;
+    }
+    EBML_Element *old = &element_list[i];
+    if (old->doctypes & elem.doctypes) {
+        printf("[INFO] redefining element '%s'\n", old->name.cstr);
+        elem.doctypes |= old->doctypes;
+        *old = elem;
+        return;
+    }
+    if (!equal(old->name, elem.name) || !same_path(old->path, elem.path) || old->type != elem.type) {
+        printf("[ERROR] the id 0x%lX is '%s' in one DocType and '%s' in another\n", elem.id, old->name.cstr, elem.name.cstr);
+        exit(1);
+    }
+    old->doctypes |= elem.doctypes;
+}
+
+size_t find_element(const char *path) {
+    EBML_Path p = parse_path(shortf("%s", path));
     for (size_t i=0; i<element_count; i++) {
-        if (elem.id == element_list[i].id) {
-            printf("[INFO] redefining element '%s'\n", element_list[i].name.cstr);
-            element_list[i] = elem;
-            return;
+        if (same_path(element_list[i].path, p)) return i;
+    }
+    return NO_ELEMENT;
+}
+
+// the EBML header and the global elements are part of every DocType
+void append_default_elements(void) {
+    for (size_t i=0; i<sizeof(default_header)/sizeof(default_header[0]); i++) {
+        EBML_Element elem = process_element(default_header[i]);
+        elem.doctypes = ALL_DOCTYPES;
+        append_element(elem);
+    }
+    for (size_t i=0; i<sizeof(global_elements)/sizeof(global_elements[0]); i++) {
+        EBML_Element elem = process_element(global_elements[i]);
+        elem.doctypes = ALL_DOCTYPES;
+        append_element(elem);
+    }
+}
+
+#define NO_PARENT SIZE_MAX
+
+// the names of the first `depth` levels of a path
+uint64_t hash_path(EBML_Path path, size_t depth) {
+    uint64_t h = 0xCBF29CE484222325;
+    for (size_t i=0; i<depth; i++) {
+        for (const char *c = path.names[i].cstr; *c != '\0'; c++) h = (h ^ (uint8_t) *c) * 0x100000001B3;
+        h = (h ^ '\\') * 0x100000001B3;
+    }
+    return h;
+}
+
+// the parent of an element is the master whose path is its path without the last level, preferably of its DocType
+void compute_parents(void) {
+    size_t size = 64;
+    while (size < 2*element_count) size *= 2;
+    size_t *masters = arena_alloc(size * sizeof(*masters));
+    for (size_t h=0; h<size; h++) masters[h] = NO_ELEMENT;
+    for (size_t j=0; j<element_count; j++) {
+        if (element_list[j].type != MASTER) continue;
+        EBML_Path path = element_list[j].path;
+        size_t h = hash_path(path, path.depth) & (size - 1);
+        while (masters[h] != NO_ELEMENT) h = (h + 1) & (size - 1);
+        masters[h] = j;
+    }
+    for (size_t i=0; i<element_count; i++) {
+        element_parent[i] = NO_PARENT;
+        EBML_Path path = element_list[i].path;
+        if (path.depth == 0) continue;
+        for (size_t h = hash_path(path, path.depth - 1) & (size - 1); masters[h] != NO_ELEMENT; h = (h + 1) & (size - 1)) {
+            size_t m = masters[h];
+            if (!is_parent_of(element_list[m].path, path)) continue;
+            if (element_parent[i] == NO_PARENT) element_parent[i] = m;
+            if (element_list[m].doctypes & element_list[i].doctypes) {
+                element_parent[i] = m;
+                break;
+            }
+        }
+    }
+}
+
+// how many levels recursive elements may contain themselves below the one of their path
+#define MAX_RECURSION 1
+
+size_t max_depth = 0;
+
+// one bit per level of the stack has to fit into a uint64_t
+#define MAX_SCHEMA_DEPTH 63
+
+// the deepest level any element can appear at, global elements go one below the deepest master
+void compute_max_depth(void) {
+    size_t master_depth = 0;
+    max_depth = 0;
+    for (size_t i=0; i<element_count; i++) {
+        EBML_Path path = element_list[i].path;
+        if (path.depth > 0 && path.global[0]) continue;
+        size_t depth = path.depth;
+        for (size_t j=0; j<path.depth; j++) {
+            if (path.recursive[j]) {
+                depth += MAX_RECURSION;
+                break;
+            }
+        }
+        if (depth > max_depth) max_depth = depth;
+        if (element_list[i].type == MASTER && depth > master_depth) master_depth = depth;
+    }
+    if (master_depth + 1 > max_depth) max_depth = master_depth + 1;
+    if (max_depth > MAX_SCHEMA_DEPTH) {
+        printf("[ERROR] the schema nests %zu levels deep, at most %d are supported\n", max_depth, MAX_SCHEMA_DEPTH);
+        exit(1);
+    }
+}
+
+// the children of a master that a validating parser counts, one bit per child and level
+#define MAX_OCCURS_BITS 64
+#define NO_OCCURS   0xFF
+#define OCCURS_ONCE 0x40
+uint8_t *element_occurs = NULL;
+uint64_t *element_required = NULL;
+
+void compute_occurrences(void) {
+    element_occurs   = arena_alloc(element_count * sizeof(*element_occurs));
+    element_required = arena_alloc(element_count * sizeof(*element_required));
+    size_t *next_bit = arena_alloc(element_count * sizeof(*next_bit));
+    size_t uncounted = 0;
+    for (size_t i=0; i<element_count; i++) {
+        EBML_Element elem = element_list[i];
+        size_t parent = element_parent[i];
+        bool once = elem.max_occurs == 1;
+        // with several DocTypes a child is only required if it is part of every DocType of its parent
+        bool required = elem.min_occurs > 0 && elem.default_value.cstr[0] == '\0'
+                     && (parent == NO_PARENT || (element_list[parent].doctypes & ~elem.doctypes) == 0);
+        element_occurs[i] = NO_OCCURS;
+        if (parent == NO_PARENT || (!once && !required)) continue;
+        if (next_bit[parent] == MAX_OCCURS_BITS) {
+            uncounted++;
+            continue;
+        }
+        size_t bit = next_bit[parent]++;
+        element_occurs[i] = bit | (once ? OCCURS_ONCE : 0);
+        if (required) element_required[parent] |= (uint64_t) 1 << bit;
+    }
+    if (uncounted > 0) printf("[INFO] the occurrences of %zu elements are not checked, their parents have too many constrained children\n", uncounted);
+}
+
+// the children of a master that have a default, one bit per child and open master
+#define MAX_DEFAULT_BITS 64
+#define NO_DEFAULT_BIT 0xFF
+Short_String *element_default_row = NULL;
+uint8_t *element_default_bit = NULL;
+size_t *element_default_children = NULL;
+
+Short_String default_value_row(EBML_Element elem) {
+    const char *s = elem.default_value.cstr;
+    char *end;
+    errno = 0;
+    switch (elem.type) {
+        case UINTEGER: {
+            uint64_t value = strtoull(s, &end, 10);
+            if (errno == 0 && end != s && *end == '\0') return shortf(".value = %lu", value);
+            break;
+        }
+        case INTEGER:
+        case DATE: {
+            int64_t value = strtoll(s, &end, 10);
+            if (errno == 0 && end != s && *end == '\0') return shortf(".int_value = %ld", value);
+            break;
+        }
+        case FLOAT: {
+            double value = strtod(s, &end);
+            if (errno == 0 && end != s && *end == '\0') return shortf(".float_value = %a", value);
+            break;
+        }
+        case UTF_8:
+        case STRING: {
+            size_t length = strlen(s);
+            // every byte may need an escape
+            if (2*length + 48 > SHORT_STRING_LENGTH) break;
+            Short_String literal = {0};
+            size_t n = 0;
+            for (size_t i=0; i<length; i++) {
+                if (s[i] == '"' || s[i] == '\\') literal.cstr[n++] = '\\';
+                literal.cstr[n++] = s[i];
+            }
+            return shortf(".string = \"%s\", .string_length = %zu", literal.cstr, length);
+        }
+        case MASTER:
+        case BINARY:
+            break;
+        case EBML_TYPE_COUNT:
+            UNREACHABLE("EBML_TYPE_COUNT is not a valid EBML_Type");
+    }
+    printf("[INFO] the default '%s' of '%s' is not used\n", s, elem.name.cstr);
+    return (Short_String) {0};
+}
+
+void compute_defaults(void) {
+    element_default_row      = arena_alloc(element_count * sizeof(*element_default_row));
+    element_default_bit      = arena_alloc(element_count * sizeof(*element_default_bit));
+    element_default_children = arena_alloc(element_count * sizeof(*element_default_children));
+    size_t unfilled = 0;
+    for (size_t i=0; i<element_count; i++) {
+        EBML_Element elem = element_list[i];
+        size_t parent = element_parent[i];
+        element_default_bit[i] = NO_DEFAULT_BIT;
+        if (elem.default_value.cstr[0] != '\0') element_default_row[i] = default_value_row(elem);
+        if (element_default_row[i].cstr[0] == '\0' || parent == NO_PARENT) continue;
+        if (element_default_children[parent] == MAX_DEFAULT_BITS) {
+            unfilled++;
+            continue;
+        }
+        element_default_bit[i] = element_default_children[parent]++;
+    }
+    if (unfilled > 0) printf("[INFO] the defaults of %zu elements are not filled in, their parents have too many children with a default\n", unfilled);
+}
+
+#define HASH_BUCKET_LOAD 2
+#define HASH_MAX_DISPLACEMENT (1 << 24)
+size_t hash_bucket_count = 0;
+
+// minimal perfect hash over the ids in element_list (hash and displace), the slots are 0..element_count-1
+void build_perfect_hash(void) {
+    assert(element_count > 0);
+    hash_bucket_count = (element_count + HASH_BUCKET_LOAD - 1) / HASH_BUCKET_LOAD;
+    size_t *bucket_size = arena_alloc(hash_bucket_count * sizeof(*bucket_size));
+    size_t max_bucket_size = 0;
+    for (size_t i=0; i<element_count; i++) {
+        size_t b = hash_id(element_list[i].id, 0) % hash_bucket_count;
+        bucket_size[b]++;
+        if (bucket_size[b] > max_bucket_size) max_bucket_size = bucket_size[b];
+    }
+    // the elements sorted by bucket, the members of bucket b start at bucket_start[b]
+    size_t *bucket_start = arena_alloc((hash_bucket_count + 1) * sizeof(*bucket_start));
+    for (size_t b=0; b<hash_bucket_count; b++) bucket_start[b+1] = bucket_start[b] + bucket_size[b];
+    size_t *bucket_members = arena_alloc(element_count * sizeof(*bucket_members));
+    size_t *bucket_fill = arena_alloc(hash_bucket_count * sizeof(*bucket_fill));
+    for (size_t i=0; i<element_count; i++) {
+        size_t b = hash_id(element_list[i].id, 0) % hash_bucket_count;
+        bucket_members[bucket_start[b] + bucket_fill[b]] = i;
+        bucket_fill[b]++;
+    }
+    bool *taken = arena_alloc(element_count * sizeof(*taken));
+    // the ids of the bucket that is placed, the search for a displacement should not touch the large elements
+    uint64_t *member_ids = arena_alloc(max_bucket_size * sizeof(*member_ids));
+    for (size_t size=max_bucket_size; size>0; size--) {
+        for (size_t b=0; b<hash_bucket_count; b++) {
+            if (bucket_size[b] != size) continue;
+            size_t *members = bucket_members + bucket_start[b];
+            size_t member_count = bucket_size[b];
+            for (size_t k=0; k<member_count; k++) member_ids[k] = element_list[members[k]].id;
+            uint32_t d = 1;
+            for (; d<HASH_MAX_DISPLACEMENT; d++) {
+                bool fits = true;
+                for (size_t k=0; k<member_count && fits; k++) {
+                    size_t slot = hash_id(member_ids[k], d) % element_count;
+                    if (taken[slot]) fits = false;
+                    for (size_t l=0; l<k && fits; l++) {
+                        if (element_slot[members[l]] == slot) fits = false;
+                    }
+                    element_slot[members[k]] = slot;
+                }
+                if (fits) break;
+            }
+            if (d == HASH_MAX_DISPLACEMENT) {
+                UNIMPLEMENTED("no displacement found for perfect hash");
+            }
+            hash_displacement[b] = d;
+            for (size_t k=0; k<member_count; k++) {
+                taken[element_slot[members[k]]] = true;
+                slot_element[element_slot[members[k]]] = members[k];
+            }
         }
     }
-    append_element(elem);
+}
+
+size_t perfect_hash_slot(uint64_t id) {
+    uint32_t d = hash_displacement[hash_id(id, 0) % hash_bucket_count];
+    return hash_id(id, d) % element_count;
+}
+
+// the smallest unsigned type that can hold the values 0..max
+const char *uint_type_for(uint64_t max) {
+    if (max <= UINT8_MAX)  return "uint8_t";
+    if (max <= UINT16_MAX) return "uint16_t";
+    if (max <= UINT32_MAX) return "uint32_t";
+    return "uint64_t";
+}
+
+// one bit per level of the stack (unknown sizes, levels entered by the validation)
+const char *depth_mask_type(void) {
+    return uint_type_for(((uint64_t) 1 << max_depth) - 1);
+}
+
+const char *element_index_type(void) {
+    return uint_type_for(element_count);
+}
+
+// one bit per child with a default of the master element that has the most of them
+const char *presence_type(void) {
+    size_t most = 0;
+    for (size_t i=0; i<element_count; i++) {
+        if (element_default_children[i] > most) most = element_default_children[i];
+    }
+    return most >= 64 ? "uint64_t" : uint_type_for(((uint64_t) 1 << most) - 1);
+}
+
+typedef enum {
+    ELEMENT_FLAG_UNKNOWN_SIZE = 1,
+    ELEMENT_FLAG_RECURSIVE    = 2,
+    ELEMENT_FLAG_GLOBAL       = 4,
+} Element_Flag;
+
+int element_flags(EBML_Element elem) {
+    int flags = 0;
+    if (elem.unknown_size_allowed)                   flags |= ELEMENT_FLAG_UNKNOWN_SIZE;
+    if (elem.recursive)                              flags |= ELEMENT_FLAG_RECURSIVE;
+    if (elem.path.depth > 0 && elem.path.global[0]) flags |= ELEMENT_FLAG_GLOBAL;
+    return flags;
 }
 
 #define line() fprintf(target_file, "\n")
@@ -745,17 +1235,39 @@ CHECK_PRINTF_FMT(3, 4) void print_line(FILE *stream, int depth, char *format, ..
     fprintf(stream, "\n");
 }
 
-#define MAX_STACK_SIZE 8
 #define STRING_BUFFER_SIZE 1024
+#define LEAN_STATE_SIZE 128
+// the writer collects its output and the binary payloads it does not copy in this many iovecs
+#define WRITER_IOV_COUNT 64
+// binary payloads below this size are copied into the output buffer, larger ones are passed to writev
+#define WRITER_COPY_LIMIT 256
 #define PREFIX      TARGET_LIBRARY_NAME
 #define PREFIX_CAPS capitalize(shortf("%s", PREFIX))
 
+// a lean parser keeps only the structure of the stream, the values go into a separate buffer (if at all)
+bool lean_state = false;
+
 typedef enum {
     API_TYPE_VOID,
     API_TYPE_RETURN,
     API_TYPE_BYTE,
+    API_TYPE_FILTER,
+    API_TYPE_VALUES,
+    API_TYPE_STATS,
+    API_TYPE_VIOLATION,
+    API_TYPE_VALIDATION,
     API_TYPE_PARSER,
+    API_TYPE_UNIT,
     API_TYPE_TYPE,
+    API_TYPE_ELEMENT,
+    API_TYPE_CURSOR,
+    API_TYPE_VISITOR,
+    API_TYPE_DEFAULT,
+    API_TYPE_READER,
+    API_TYPE_BOOL,
+    API_TYPE_WRITER,
+    API_TYPE_NODE,
+    API_TYPE_BLOCK,
     API_TYPE_COUNT,
 } Api_Type;
 
@@ -763,8 +1275,23 @@ const char *api_type_name[] = {
     [API_TYPE_VOID]   = "void",
     [API_TYPE_RETURN] = PREFIX "_return_t",
     [API_TYPE_BYTE]   = PREFIX "_byte_t",
+    [API_TYPE_VALUES] = PREFIX "_values_t",
     [API_TYPE_PARSER] = PREFIX "_parser_t",
     [API_TYPE_TYPE]   = "size_t",
+    [API_TYPE_ELEMENT] = PREFIX "_element_t",
+    [API_TYPE_CURSOR]  = PREFIX "_cursor_t",
+    [API_TYPE_VISITOR] = PREFIX "_visitor_t",
+    [API_TYPE_DEFAULT] = PREFIX "_default_t",
+    [API_TYPE_FILTER]  = PREFIX "_filter_t",
+    [API_TYPE_READER]  = PREFIX "_reader_t",
+    [API_TYPE_UNIT]    = PREFIX "_unit_t",
+    [API_TYPE_BOOL]    = "bool",
+    [API_TYPE_WRITER]  = PREFIX "_writer_t",
+    [API_TYPE_NODE]    = PREFIX "_node_t",
+    [API_TYPE_BLOCK]   = PREFIX "_block_t",
+    [API_TYPE_STATS]   = PREFIX "_stats_t",
+    [API_TYPE_VIOLATION]  = PREFIX "_violation_t",
+    [API_TYPE_VALIDATION] = PREFIX "_validation_t",
 };
 static_assert(sizeof(api_type_name)/sizeof(api_type_name[0]) == API_TYPE_COUNT);
 
@@ -773,6 +1300,7 @@ typedef enum {
     API_RETURN_VALUE_OK,
     API_RETURN_VALUE_START,
     API_RETURN_VALUE_END,
+    API_RETURN_VALUE_SKIP,
     API_RETURN_VALUE_COUNT,
 } Api_Return_Value;
 
@@ -781,6 +1309,7 @@ const char *api_return_value_suffix[] = {
     [API_RETURN_VALUE_OK]    = "OK",
     [API_RETURN_VALUE_START] = "ELEMSTART",
     [API_RETURN_VALUE_END]   = "ELEMEND",
+    [API_RETURN_VALUE_SKIP]  = "SKIP",
 };
 static_assert(sizeof(api_return_value_suffix)/sizeof(api_return_value_suffix[0]) == API_RETURN_VALUE_COUNT);
 
@@ -789,6 +1318,7 @@ int api_return_value_number[] = {
     [API_RETURN_VALUE_OK]    = 0,
     [API_RETURN_VALUE_START] = 1,
     [API_RETURN_VALUE_END]   = 2,
+    [API_RETURN_VALUE_SKIP]  = 3,
 };
 static_assert(sizeof(api_return_value_number)/sizeof(api_return_value_number[0]) == API_RETURN_VALUE_COUNT);
 
@@ -796,30 +1326,318 @@ Short_String api_return_value_name(Api_Return_Value v) {
     return shortf("%s_%s", PREFIX_CAPS.cstr, api_return_value_suffix[v]);
 }
 
+// per open master the children with a default that were there so far, for value_or_default
+void define_presence_fields(FILE *f) {
+    print_line(f, 1, "%s present[%s_MAX_DEPTH];", presence_type(), PREFIX_CAPS.cstr);
+    print_line(f, 1, "%s masters[%s_MAX_DEPTH];", element_index_type(), PREFIX_CAPS.cstr);
+    print_line(f, 1, "%s value_elem;", element_index_type());
+}
+
+// per level only the end of the body and the element index, ordered by alignment
 void define_parser_type(FILE *f) {
     print_line(f, 0, "typedef struct {");
     // fields meant for internal usage, the library user should not be concerned about them
-    print_line(f, 1,     "size_t offset;");
-    print_line(f, 1,     "size_t depth;");
-    print_line(f, 1,     "size_t id_offset[%d];", MAX_STACK_SIZE);
-    print_line(f, 1,     "size_t size_offset[%d];", MAX_STACK_SIZE);
-    print_line(f, 1,     "size_t body_offset[%d];", MAX_STACK_SIZE);
-    print_line(f, 1,     "uint64_t id[%d];", MAX_STACK_SIZE);
-    print_line(f, 1,     "uint64_t size[%d];", MAX_STACK_SIZE);
+    print_line(f, 1,     "uint64_t offset;");
+    print_line(f, 1,     "uint64_t end[%s_MAX_DEPTH];", PREFIX_CAPS.cstr);
     // fields meant for the user to extract information
-    print_line(f, 1,     "size_t this_depth;");
-    print_line(f, 1,     "char *name;");
-    print_line(f, 1,     "%s type;", api_type_name[API_TYPE_TYPE]);
+    print_line(f, 1,     "uint64_t this_header_offset;");
+    print_line(f, 1,     "uint64_t skip_bytes;");
+    if (!lean_state) {
+        print_line(f, 1, "uint64_t skipped_bytes;");
+        print_line(f, 1, "uint64_t id;");
+        print_line(f, 1, "uint64_t value;");
+        print_line(f, 1, "int64_t int_value;");
+        print_line(f, 1, "double float_value;");
+        print_line(f, 1, "size_t string_length;");
+        print_line(f, 1, "const char *name;");
+        print_line(f, 1, "%s type;", api_type_name[API_TYPE_TYPE]);
+    }
+    // fields meant for the user to configure the parser
+    print_line(f, 1,     "const %s *filter;", api_type_name[API_TYPE_FILTER]);
+    if (lean_state) print_line(f, 1, "%s *values;", api_type_name[API_TYPE_VALUES]);
+    print_line(f, 0,     "#ifdef %s_STATS", PREFIX_CAPS.cstr);
+    print_line(f, 1,     "%s *stats;", api_type_name[API_TYPE_STATS]);
+    print_line(f, 0,     "#endif");
+    print_line(f, 0,     "#ifdef %s_VALIDATE", PREFIX_CAPS.cstr);
+    print_line(f, 1,     "%s *validation;", api_type_name[API_TYPE_VALIDATION]);
+    print_line(f, 0,     "#endif");
+    // fields meant for internal usage
+    print_line(f, 1,     "%s elem[%s_MAX_DEPTH];", element_index_type(), PREFIX_CAPS.cstr);
+    if (!lean_state) define_presence_fields(f);
+    print_line(f, 1,     "uint8_t depth;");
+    if (lean_state && multiple_doctypes()) {
+        // both are at most 8, this makes room for the DocType in a lean parser
+        print_line(f, 1, "uint8_t id_length : 4;");
+        print_line(f, 1, "uint8_t size_length : 4;");
+    } else {
+        print_line(f, 1, "uint8_t id_length;");
+        print_line(f, 1, "uint8_t size_length;");
+    }
+    print_line(f, 1,     "uint8_t header_length;");
+    // one bit per level, the size of such an element is the rest of its parent
+    print_line(f, 1,     "%s unknown_size;", depth_mask_type());
+    // fields meant for the user to extract information
+    print_line(f, 1,     "uint8_t this_depth;");
+    print_line(f, 1,     "uint8_t this_header_length;");
+    // fields meant for the user to configure the parser
+    print_line(f, 1,     "bool skip_binary;");
+    // set from the EBML header, until then (or for an unknown DocType) the elements of all DocTypes are accepted
+    if (multiple_doctypes()) print_line(f, 1, "uint8_t doctype;");
+    if (!lean_state) print_line(f, 1, "char string_buffer[%d];", STRING_BUFFER_SIZE);
+    print_line(f, 0, "} %s;", api_type_name[API_TYPE_PARSER]);
+    if (lean_state) {
+        // the stats and validation pointers of an instrumented build are the only fields allowed to go beyond
+        print_line(f, 0, "#if !defined(%s_STATS) && !defined(%s_VALIDATE)", PREFIX_CAPS.cstr, PREFIX_CAPS.cstr);
+        print_line(f, 0, "static_assert(sizeof(%s) <= %d, \"a lean parser has to fit into two cache lines\");", api_type_name[API_TYPE_PARSER], LEAN_STATE_SIZE);
+        print_line(f, 0, "#endif");
+    }
+}
+
+// where a lean parser collects the value of the current element
+void define_values_type(FILE *f) {
+    print_line(f, 0, "typedef struct {");
     print_line(f, 1,     "uint64_t value;");
+    print_line(f, 1,     "int64_t int_value;");
+    print_line(f, 1,     "double float_value;");
     print_line(f, 1,     "size_t string_length;");
+    define_presence_fields(f);
     print_line(f, 1,     "char string_buffer[%d];", STRING_BUFFER_SIZE);
-    print_line(f, 0, "} %s;", api_type_name[API_TYPE_PARSER]);
+    print_line(f, 0, "} %s;", api_type_name[API_TYPE_VALUES]);
+}
+
+void define_element_type(FILE *f) {
+    print_line(f, 0, "typedef struct {");
+    print_line(f, 1,     "uint64_t id;");
+    print_line(f, 1,     "size_t index;");
+    print_line(f, 1,     "size_t depth;");
+    print_line(f, 1,     "%s type;", api_type_name[API_TYPE_TYPE]);
+    print_line(f, 1,     "const char *name;");
+    print_line(f, 1,     "size_t header_offset;");
+    print_line(f, 1,     "size_t body_offset;");
+    print_line(f, 1,     "const %s *body;", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 1,     "uint64_t body_length;");
+    print_line(f, 1,     "bool unknown_size;");
+    print_line(f, 0, "} %s;", api_type_name[API_TYPE_ELEMENT]);
+}
+
+void define_cursor_type(FILE *f) {
+    print_line(f, 0, "typedef struct {");
+    print_line(f, 1,     "const %s *data;", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 1,     "size_t length;");
+    print_line(f, 1,     "size_t offset;");
+    print_line(f, 1,     "size_t depth;");
+    print_line(f, 1,     "size_t end[%s_MAX_DEPTH];", PREFIX_CAPS.cstr);
+    print_line(f, 1,     "%s elem[%s_MAX_DEPTH];", element_index_type(), PREFIX_CAPS.cstr);
+    print_line(f, 1,     "%s unknown_size;", depth_mask_type());
+    if (multiple_doctypes()) print_line(f, 1, "uint8_t doctype;");
+    print_line(f, 0, "} %s;", api_type_name[API_TYPE_CURSOR]);
+}
+
+// element names may contain characters like '-' that are not allowed in C identifiers
+Short_String c_identifier(Short_String name) {
+    for (size_t i=0; i<SHORT_STRING_LENGTH && name.cstr[i] != '\0'; i++) {
+        if (!isalnum(name.cstr[i])) name.cstr[i] = '_';
+    }
+    return name;
+}
+
+Short_String visitor_params(EBML_Type type) {
+    switch (type) {
+        case MASTER:
+            return shortf("void *user");
+        case UINTEGER:
+            return shortf("void *user, uint64_t value");
+        case INTEGER:
+        case DATE:
+            return shortf("void *user, int64_t value");
+        case FLOAT:
+            return shortf("void *user, double value");
+        case UTF_8:
+        case STRING:
+            return shortf("void *user, const char *value, size_t length");
+        case BINARY:
+            return shortf("void *user, const %s *value, size_t length", api_type_name[API_TYPE_BYTE]);
+        case EBML_TYPE_COUNT:
+            UNREACHABLE("EBML_TYPE_COUNT is not a valid EBML_Type");
+    }
+    UNREACHABLE("no valid EBML_Type");
+}
+
+// one optional handler per element, in the order of the element indices
+void define_visitor_type(FILE *f) {
+    print_line(f, 0, "typedef struct {");
+    for (size_t slot=0; slot<element_count; slot++) {
+        EBML_Element elem = element_list[slot_element[slot]];
+        print_line(f, 1, "void (*on_%s)(%s);", c_identifier(elem.name).cstr, visitor_params(elem.type).cstr);
+    }
+    // the handlers of the children with a default that are not there get the default, when their master element ends
+    print_line(f, 1, "bool defaults;");
+    print_line(f, 0, "} %s;", api_type_name[API_TYPE_VISITOR]);
+}
+
+// The default value of an element from the schema, in the field of its type. The string is zero terminated.
+void define_default_type(FILE *f) {
+    print_line(f, 0, "typedef struct {");
+    print_line(f, 1,     "uint64_t value;");
+    print_line(f, 1,     "int64_t int_value;");
+    print_line(f, 1,     "double float_value;");
+    print_line(f, 1,     "const char *string;");
+    print_line(f, 1,     "size_t string_length;");
+    print_line(f, 0, "} %s;", api_type_name[API_TYPE_DEFAULT]);
+}
+
+size_t element_bitset_words(void) {
+    return (element_count + 63) / 64;
+}
+
+// one bit per element index that is either subscribed, inside a subscribed element or may contain one
+void define_filter_type(FILE *f) {
+    print_line(f, 0, "typedef struct {");
+    print_line(f, 1,     "uint64_t wanted[%zu];", element_bitset_words());
+    print_line(f, 0, "} %s;", api_type_name[API_TYPE_FILTER]);
+}
+
+// positioned reads, `read` returns how many bytes it could read at `offset`
+void define_reader_type(FILE *f) {
+    print_line(f, 0, "typedef struct {");
+    print_line(f, 1,     "void *user;");
+    print_line(f, 1,     "size_t (*read)(void *user, uint64_t offset, %s *buf, size_t length);", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "} %s;", api_type_name[API_TYPE_READER]);
+}
+
+// an element of a tree for libexample_serialize, `children` is only used by master elements
+void define_node_type(FILE *f) {
+    print_line(f, 0, "typedef struct %s_node {", PREFIX);
+    // fields meant for the user to describe the element
+    print_line(f, 1,     "uint64_t id;");
+    print_line(f, 1,     "uint64_t value;");
+    print_line(f, 1,     "int64_t int_value;");
+    print_line(f, 1,     "double float_value;");
+    print_line(f, 1,     "const %s *data;", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 1,     "size_t length;");
+    print_line(f, 1,     "struct %s_node *children;", PREFIX);
+    print_line(f, 1,     "size_t child_count;");
+    // fields meant for internal usage, filled in by the first pass
+    print_line(f, 1,     "uint64_t body_length;");
+    print_line(f, 0, "} %s;", api_type_name[API_TYPE_NODE]);
+}
+
+// The header of a SimpleBlock or Block. `header_length` is where the first frame starts, after the lacing if it was decoded.
+void define_block_type(FILE *f) {
+    print_line(f, 0, "typedef struct {");
+    print_line(f, 1,     "uint64_t track;");
+    print_line(f, 1,     "size_t header_length;");
+    print_line(f, 1,     "size_t frame_count;");
+    print_line(f, 1,     "int16_t timecode;");
+    print_line(f, 1,     "uint8_t flags;");
+    print_line(f, 1,     "uint8_t lacing;");
+    print_line(f, 0, "} %s;", api_type_name[API_TYPE_BLOCK]);
+}
+
+// only there with LIBEXAMPLE_STATS, counts per element and per return value
+void define_stats_type(FILE *f) {
+    print_line(f, 0, "#ifdef %s_STATS", PREFIX_CAPS.cstr);
+    print_line(f, 0, "#include <stdio.h>");
+    print_line(f, 0, "typedef struct {");
+    print_line(f, 1,     "struct {");
+    print_line(f, 2,         "uint64_t count;");
+    print_line(f, 2,         "uint64_t header_bytes;");
+    // elements of unknown size add no body bytes, their children do
+    print_line(f, 2,         "uint64_t body_bytes;");
+    print_line(f, 2,         "uint64_t skipped_bytes;");
+    print_line(f, 2,         "uint64_t max_depth;");
+    print_line(f, 1,     "} elements[%s_ELEMENT_COUNT];", PREFIX_CAPS.cstr);
+    print_line(f, 1,     "uint64_t events[%d];", API_RETURN_VALUE_COUNT);
+    print_line(f, 1,     "uint64_t cycles[%d];", API_RETURN_VALUE_COUNT);
+    print_line(f, 0, "} %s;", api_type_name[API_TYPE_STATS]);
+    print_line(f, 0, "#endif");
+}
+
+typedef enum {
+    VIOLATION_RANGE,
+    VIOLATION_LENGTH,
+    VIOLATION_MISSING,
+    VIOLATION_REPEATED,
+    VIOLATION_MISPLACED,
+    VIOLATION_COUNT,
+} Violation;
+
+const char *violation_suffix[] = {
+    [VIOLATION_RANGE]    = "RANGE",
+    [VIOLATION_LENGTH]   = "LENGTH",
+    [VIOLATION_MISSING]  = "MISSING",
+    [VIOLATION_REPEATED] = "REPEATED",
+    [VIOLATION_MISPLACED] = "MISPLACED",
+};
+static_assert(sizeof(violation_suffix)/sizeof(violation_suffix[0]) == VIOLATION_COUNT);
+
+Short_String violation_name(Violation v) {
+    return shortf("%s_VIOLATION_%s", PREFIX_CAPS.cstr, violation_suffix[v]);
+}
+
+void define_violation_type(FILE *f) {
+    print_line(f, 0, "#ifdef %s_VALIDATE", PREFIX_CAPS.cstr);
+    print_line(f, 0, "typedef enum {");
+    print_line(f, 1,     "%s, // the value is outside of the range of the element", violation_name(VIOLATION_RANGE).cstr);
+    print_line(f, 1,     "%s, // the body does not have the length of the element", violation_name(VIOLATION_LENGTH).cstr);
+    print_line(f, 1,     "%s, // a mandatory child without a default value is not there", violation_name(VIOLATION_MISSING).cstr);
+    print_line(f, 1,     "%s, // an element that may be there once is there again", violation_name(VIOLATION_REPEATED).cstr);
+    print_line(f, 1,     "%s, // an element that is not a child of its parent, it is skipped", violation_name(VIOLATION_MISPLACED).cstr);
+    print_line(f, 0, "} %s;", api_type_name[API_TYPE_VIOLATION]);
+    print_line(f, 0, "#define %s_VIOLATION_COUNT %d", PREFIX_CAPS.cstr, VIOLATION_COUNT);
+    print_line(f, 0, "#endif");
+}
+
+// only there with LIBEXAMPLE_VALIDATE, zeroed before use, calls `on_violation` for every constraint that does not hold
+void define_validation_type(FILE *f) {
+    print_line(f, 0, "#ifdef %s_VALIDATE", PREFIX_CAPS.cstr);
+    print_line(f, 0, "typedef struct {");
+    print_line(f, 1,     "void (*on_violation)(void *user, %s violation, uint64_t id, const char *name, uint64_t offset);", api_type_name[API_TYPE_VIOLATION]);
+    print_line(f, 1,     "void *user;");
+    print_line(f, 1,     "uint64_t violations;");
+    // per level the children that were seen in the master element of that level, if this parser saw it start
+    print_line(f, 1,     "uint64_t seen[%s_MAX_DEPTH];", PREFIX_CAPS.cstr);
+    print_line(f, 1,     "%s entered;", depth_mask_type());
+    print_line(f, 1,     "bool skipped;");
+    print_line(f, 0, "} %s;", api_type_name[API_TYPE_VALIDATION]);
+    print_line(f, 0, "#endif");
+}
+
+#define POSIX_GUARD "defined(__unix__) || defined(__APPLE__)"
+
+// the output is buffered in `buf` and written out with writev, with the position of every open size
+void define_writer_type(FILE *f) {
+    print_line(f, 0, "#if %s", POSIX_GUARD);
+    print_line(f, 0, "#include <sys/uio.h>");
+    print_line(f, 0, "typedef struct {");
+    // fields meant for internal usage, the library user should not be concerned about them
+    print_line(f, 1,     "%s *buf;", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 1,     "size_t capacity;");
+    print_line(f, 1,     "size_t count;");
+    print_line(f, 1,     "size_t iov_start;");
+    print_line(f, 1,     "size_t iov_count;");
+    print_line(f, 1,     "int64_t fd_offset;");
+    print_line(f, 1,     "uint64_t flushed;");
+    print_line(f, 1,     "uint64_t size_offset[%s_MAX_DEPTH];", PREFIX_CAPS.cstr);
+    print_line(f, 1,     "size_t size_at[%s_MAX_DEPTH];", PREFIX_CAPS.cstr);
+    print_line(f, 1,     "struct iovec iov[%d];", WRITER_IOV_COUNT);
+    // fields meant for the user to extract information
+    print_line(f, 1,     "uint64_t offset;");
+    // fields meant for the user to configure the writer
+    print_line(f, 1,     "size_t size_length;");
+    print_line(f, 1,     "int fd;");
+    // fields meant for internal usage
+    print_line(f, 1,     "%s elem[%s_MAX_DEPTH];", element_index_type(), PREFIX_CAPS.cstr);
+    print_line(f, 1,     "uint8_t depth;");
+    print_line(f, 0, "} %s;", api_type_name[API_TYPE_WRITER]);
+    print_line(f, 0, "#endif");
 }
 
 void define_api_type(FILE *f, Api_Type t) {
     switch (t) {
         case API_TYPE_TYPE:
         case API_TYPE_VOID:
+        case API_TYPE_BOOL:
             return;
         case API_TYPE_RETURN:
             print_line(f, 0, "typedef enum {");
@@ -831,9 +1649,52 @@ void define_api_type(FILE *f, Api_Type t) {
         case API_TYPE_BYTE:
             print_line(f, 0, "typedef unsigned char %s;", api_type_name[API_TYPE_BYTE]);
             return;
+        case API_TYPE_VALUES:
+            if (lean_state) define_values_type(f);
+            return;
+        case API_TYPE_STATS:
+            define_stats_type(f);
+            return;
+        case API_TYPE_VIOLATION:
+            define_violation_type(f);
+            return;
+        case API_TYPE_VALIDATION:
+            define_validation_type(f);
+            return;
         case API_TYPE_PARSER:
             define_parser_type(f);
             return;
+        case API_TYPE_ELEMENT:
+            define_element_type(f);
+            return;
+        case API_TYPE_CURSOR:
+            define_cursor_type(f);
+            return;
+        case API_TYPE_VISITOR:
+            define_visitor_type(f);
+            return;
+        case API_TYPE_DEFAULT:
+            define_default_type(f);
+            return;
+        case API_TYPE_FILTER:
+            define_filter_type(f);
+            return;
+        case API_TYPE_READER:
+            define_reader_type(f);
+            return;
+        case API_TYPE_UNIT:
+            print_line(f, 0, "typedef %s (*%s)(void *user, size_t index, %s *p, const %s *data, size_t length);",
+                       api_type_name[API_TYPE_RETURN], api_type_name[API_TYPE_UNIT], api_type_name[API_TYPE_PARSER], api_type_name[API_TYPE_BYTE]);
+            return;
+        case API_TYPE_WRITER:
+            define_writer_type(f);
+            return;
+        case API_TYPE_NODE:
+            define_node_type(f);
+            return;
+        case API_TYPE_BLOCK:
+            define_block_type(f);
+            return;
         case API_TYPE_COUNT:
             UNREACHABLE("API_TYPE_COUNT is not a valid Api_Type");
     }
@@ -843,24 +1704,106 @@ void define_api_type(FILE *f, Api_Type t) {
 typedef enum {
     API_FUNC_INIT,
     API_FUNC_PARSE,
+    API_FUNC_PARSE_BUFFER,
+    API_FUNC_SKIP,
     API_FUNC_EOF,
     API_FUNC_PRINT,
+    API_FUNC_CURSOR_INIT,
+    API_FUNC_NEXT,
+    API_FUNC_VISIT,
+    API_FUNC_DEFAULT,
+    API_FUNC_FILTER_INIT,
+    API_FUNC_FILTER_ADD,
+    API_FUNC_INIT_AT,
+    API_FUNC_SEEK_TIME,
+    API_FUNC_SCAN_CHILDREN,
+    API_FUNC_PARSE_PARALLEL,
+    API_FUNC_RESYNC,
+    API_FUNC_CURRENT,
+    API_FUNC_VALUE_OR_DEFAULT,
+    API_FUNC_SERIALIZE,
+    API_FUNC_BLOCK_DECODE,
+    API_FUNC_STATS_DUMP,
+    // the writer functions have to stay together, from API_FUNC_WRITER_INIT to API_FUNC_WRITER_FLUSH
+    API_FUNC_WRITER_INIT,
+    API_FUNC_BEGIN_MASTER,
+    API_FUNC_END_MASTER,
+    API_FUNC_WRITE_UINT,
+    API_FUNC_WRITE_INT,
+    API_FUNC_WRITE_FLOAT,
+    API_FUNC_WRITE_STRING,
+    API_FUNC_WRITE_BINARY,
+    API_FUNC_WRITER_FLUSH,
     API_FUNC_COUNT,
 } Api_Func;
 
 const char *api_func_suffix[] = {
     [API_FUNC_INIT]  = "init",
     [API_FUNC_PARSE] = "parse",
+    [API_FUNC_PARSE_BUFFER] = "parse_buffer",
+    [API_FUNC_SKIP]  = "skip",
     [API_FUNC_EOF]   = "eof",
     [API_FUNC_PRINT] = "print",
+    [API_FUNC_CURSOR_INIT] = "cursor_init",
+    [API_FUNC_NEXT]  = "next",
+    [API_FUNC_VISIT] = "visit",
+    [API_FUNC_DEFAULT] = "default",
+    [API_FUNC_FILTER_INIT] = "filter_init",
+    [API_FUNC_FILTER_ADD]  = "filter_add",
+    [API_FUNC_INIT_AT]     = "init_at",
+    [API_FUNC_SEEK_TIME]   = "seek_time",
+    [API_FUNC_SCAN_CHILDREN]  = "scan_children",
+    [API_FUNC_PARSE_PARALLEL] = "parse_parallel",
+    [API_FUNC_RESYNC]         = "resync",
+    [API_FUNC_CURRENT]        = "current",
+    [API_FUNC_VALUE_OR_DEFAULT] = "value_or_default",
+    [API_FUNC_SERIALIZE]      = "serialize",
+    [API_FUNC_BLOCK_DECODE]   = "block_decode",
+    [API_FUNC_STATS_DUMP]     = "stats_dump",
+    [API_FUNC_WRITER_INIT]    = "writer_init",
+    [API_FUNC_BEGIN_MASTER]   = "begin_master",
+    [API_FUNC_END_MASTER]     = "end_master",
+    [API_FUNC_WRITE_UINT]     = "write_uint",
+    [API_FUNC_WRITE_INT]      = "write_int",
+    [API_FUNC_WRITE_FLOAT]    = "write_float",
+    [API_FUNC_WRITE_STRING]   = "write_string",
+    [API_FUNC_WRITE_BINARY]   = "write_binary",
+    [API_FUNC_WRITER_FLUSH]   = "writer_flush",
 };
 static_assert(sizeof(api_func_suffix)/sizeof(api_func_suffix[0]) == API_FUNC_COUNT);
 
 Api_Type api_func_return[] = {
     [API_FUNC_INIT]  = API_TYPE_VOID,
     [API_FUNC_PARSE] = API_TYPE_RETURN,
+    [API_FUNC_PARSE_BUFFER] = API_TYPE_RETURN,
+    [API_FUNC_SKIP]  = API_TYPE_VOID,
     [API_FUNC_EOF]   = API_TYPE_RETURN,
     [API_FUNC_PRINT] = API_TYPE_VOID,
+    [API_FUNC_CURSOR_INIT] = API_TYPE_VOID,
+    [API_FUNC_NEXT]  = API_TYPE_RETURN,
+    [API_FUNC_VISIT] = API_TYPE_RETURN,
+    [API_FUNC_DEFAULT] = API_TYPE_BOOL,
+    [API_FUNC_FILTER_INIT] = API_TYPE_VOID,
+    [API_FUNC_FILTER_ADD]  = API_TYPE_BOOL,
+    [API_FUNC_INIT_AT]     = API_TYPE_RETURN,
+    [API_FUNC_SEEK_TIME]   = API_TYPE_RETURN,
+    [API_FUNC_SCAN_CHILDREN]  = API_TYPE_TYPE,
+    [API_FUNC_PARSE_PARALLEL] = API_TYPE_RETURN,
+    [API_FUNC_RESYNC]         = API_TYPE_RETURN,
+    [API_FUNC_CURRENT]        = API_TYPE_VOID,
+    [API_FUNC_VALUE_OR_DEFAULT] = API_TYPE_BOOL,
+    [API_FUNC_SERIALIZE]      = API_TYPE_TYPE,
+    [API_FUNC_BLOCK_DECODE]   = API_TYPE_RETURN,
+    [API_FUNC_STATS_DUMP]     = API_TYPE_VOID,
+    [API_FUNC_WRITER_INIT]    = API_TYPE_VOID,
+    [API_FUNC_BEGIN_MASTER]   = API_TYPE_RETURN,
+    [API_FUNC_END_MASTER]     = API_TYPE_RETURN,
+    [API_FUNC_WRITE_UINT]     = API_TYPE_RETURN,
+    [API_FUNC_WRITE_INT]      = API_TYPE_RETURN,
+    [API_FUNC_WRITE_FLOAT]    = API_TYPE_RETURN,
+    [API_FUNC_WRITE_STRING]   = API_TYPE_RETURN,
+    [API_FUNC_WRITE_BINARY]   = API_TYPE_RETURN,
+    [API_FUNC_WRITER_FLUSH]   = API_TYPE_RETURN,
 };
 static_assert(sizeof(api_func_return)/sizeof(api_func_return[0]) == API_FUNC_COUNT);
 
@@ -872,10 +1815,62 @@ Short_String api_func_params(Api_Func f) {
     switch (f) {
         case API_FUNC_PARSE:
             return shortf("%s *p, %s b", api_type_name[API_TYPE_PARSER], api_type_name[API_TYPE_BYTE]);
+        case API_FUNC_PARSE_BUFFER:
+            return shortf("%s *p, const %s *buf, size_t len, size_t *consumed", api_type_name[API_TYPE_PARSER], api_type_name[API_TYPE_BYTE]);
         case API_FUNC_INIT:
+        case API_FUNC_SKIP:
         case API_FUNC_EOF:
         case API_FUNC_PRINT:
             return shortf("%s *p", api_type_name[API_TYPE_PARSER]);
+        case API_FUNC_CURSOR_INIT:
+            return shortf("%s *cur, const %s *data, size_t length", api_type_name[API_TYPE_CURSOR], api_type_name[API_TYPE_BYTE]);
+        case API_FUNC_NEXT:
+            return shortf("%s *cur, %s *elem", api_type_name[API_TYPE_CURSOR], api_type_name[API_TYPE_ELEMENT]);
+        case API_FUNC_FILTER_INIT:
+            return shortf("%s *f", api_type_name[API_TYPE_FILTER]);
+        case API_FUNC_FILTER_ADD:
+            return shortf("%s *f, const char *path", api_type_name[API_TYPE_FILTER]);
+        case API_FUNC_INIT_AT:
+            return shortf("%s *p, const %s *parent, uint64_t offset", api_type_name[API_TYPE_PARSER], api_type_name[API_TYPE_ELEMENT]);
+        case API_FUNC_SEEK_TIME:
+            return shortf("%s *p, const %s *r, uint64_t track, uint64_t timestamp_ns, uint64_t *offset", api_type_name[API_TYPE_PARSER], api_type_name[API_TYPE_READER]);
+        case API_FUNC_SCAN_CHILDREN:
+            return shortf("const %s *parent, uint64_t *offsets, size_t max", api_type_name[API_TYPE_ELEMENT]);
+        case API_FUNC_PARSE_PARALLEL:
+            return shortf("const %s *parent, const uint64_t *offsets, size_t count, size_t threads, %s unit, void *user", api_type_name[API_TYPE_ELEMENT], api_type_name[API_TYPE_UNIT]);
+        case API_FUNC_RESYNC:
+            return shortf("%s *p, const %s *data, size_t length, size_t *skipped", api_type_name[API_TYPE_PARSER], api_type_name[API_TYPE_BYTE]);
+        case API_FUNC_CURRENT:
+            return shortf("const %s *p, %s *elem", api_type_name[API_TYPE_PARSER], api_type_name[API_TYPE_ELEMENT]);
+        case API_FUNC_VISIT:
+            return shortf("const %s *v, void *user, const %s *data, size_t length", api_type_name[API_TYPE_VISITOR], api_type_name[API_TYPE_BYTE]);
+        case API_FUNC_DEFAULT:
+            return shortf("uint64_t id, %s *value", api_type_name[API_TYPE_DEFAULT]);
+        case API_FUNC_VALUE_OR_DEFAULT:
+            return shortf("const %s *p, uint64_t id, %s *value", api_type_name[API_TYPE_PARSER], api_type_name[API_TYPE_DEFAULT]);
+        case API_FUNC_SERIALIZE:
+            return shortf("%s *nodes, size_t count, %s *buf, size_t capacity", api_type_name[API_TYPE_NODE], api_type_name[API_TYPE_BYTE]);
+        case API_FUNC_BLOCK_DECODE:
+            return shortf("const %s *data, size_t length, %s *block, size_t *frame_sizes, size_t max_frames", api_type_name[API_TYPE_BYTE], api_type_name[API_TYPE_BLOCK]);
+        case API_FUNC_STATS_DUMP:
+            return shortf("const %s *s, FILE *out", api_type_name[API_TYPE_STATS]);
+        case API_FUNC_WRITER_INIT:
+            return shortf("%s *w, %s *buf, size_t capacity, int fd", api_type_name[API_TYPE_WRITER], api_type_name[API_TYPE_BYTE]);
+        case API_FUNC_BEGIN_MASTER:
+            return shortf("%s *w, uint64_t id", api_type_name[API_TYPE_WRITER]);
+        case API_FUNC_END_MASTER:
+        case API_FUNC_WRITER_FLUSH:
+            return shortf("%s *w", api_type_name[API_TYPE_WRITER]);
+        case API_FUNC_WRITE_UINT:
+            return shortf("%s *w, uint64_t id, uint64_t value", api_type_name[API_TYPE_WRITER]);
+        case API_FUNC_WRITE_INT:
+            return shortf("%s *w, uint64_t id, int64_t value", api_type_name[API_TYPE_WRITER]);
+        case API_FUNC_WRITE_FLOAT:
+            return shortf("%s *w, uint64_t id, double value", api_type_name[API_TYPE_WRITER]);
+        case API_FUNC_WRITE_STRING:
+            return shortf("%s *w, uint64_t id, const char *value, size_t length", api_type_name[API_TYPE_WRITER]);
+        case API_FUNC_WRITE_BINARY:
+            return shortf("%s *w, uint64_t id, const %s *value, size_t length", api_type_name[API_TYPE_WRITER], api_type_name[API_TYPE_BYTE]);
         case API_FUNC_COUNT:
             UNREACHABLE("API_FUNC_COUNT is not a valid Api_Func");
     }
@@ -889,69 +1884,332 @@ Short_String api_func_signature(Api_Func f) {
 void implement_vint_length(FILE *f) {
     print_line(f, 0, "size_t vint_length(%s b) {", api_type_name[API_TYPE_BYTE]);
     print_line(f, 1,     "if (b == 0) UNIMPLEMENTED(\"zero byte in vint_length\");");
+    print_line(f, 0, "#if defined(__GNUC__) || defined(__clang__)");
+    print_line(f, 1,     "return __builtin_clz(b) - (8*sizeof(unsigned int) - 8) + 1;");
+    print_line(f, 0, "#else");
     print_line(f, 1,     "size_t acc = 1;");
     print_line(f, 1,     "for (%s mark = 0x80; (mark & b) == 0; mark>>=1) acc++;", api_type_name[API_TYPE_BYTE]);
     print_line(f, 1,     "return acc;");
+    print_line(f, 0, "#endif");
     print_line(f, 0, "}");
 }
 
 void implement_drop_first_active_bit(FILE *f) {
     print_line(f, 0, "%s drop_first_active_bit(%s x) {", api_type_name[API_TYPE_BYTE], api_type_name[API_TYPE_BYTE]);
-    print_line(f, 0, "    %s mask = ~0;", api_type_name[API_TYPE_BYTE]);
-    print_line(f, 0, "    while (mask >= x) mask >>= 1;");
-    print_line(f, 0, "    return mask & x;");
+    print_line(f, 0, "    return x & (0xFF >> vint_length(x));");
     print_line(f, 0, "}");
 }
 
-void implement_type(FILE *f) {
-    print_line(f, 0, "int type(%s *p) {", api_type_name[API_TYPE_PARSER]);
-    print_line(f, 0, "    if (p->depth == 0) return %d;", MASTER);
-    print_line(f, 0, "    uint64_t id = p->id[p->depth];");
-    print_line(f, 0, "    switch (id) {");
+// The big endian number in buf[0..length), with one unaligned load if 8 bytes can be read from buf.
+void implement_load_be(FILE *f) {
+    print_line(f, 0, "uint64_t load_be(const %s *buf, size_t avail, size_t length) {", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    uint64_t v = 0;");
+    print_line(f, 0, "#if defined(__GNUC__) || defined(__clang__)");
+    // the bytes behind the number are shifted out
+    print_line(f, 0, "    if (avail >= 8 && length > 0 && length <= 8) {");
+    print_line(f, 0, "        memcpy(&v, buf, 8);");
+    print_line(f, 0, "#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__");
+    print_line(f, 0, "        v = __builtin_bswap64(v);");
+    print_line(f, 0, "#endif");
+    print_line(f, 0, "        return v >> (64 - 8*length);");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "#endif");
+    print_line(f, 0, "    for (size_t i=0; i<length; i++) v = (v << 8) + buf[i];");
+    print_line(f, 0, "    return v;");
+    print_line(f, 0, "}");
+}
+
+// decodes a whole vint, returns its width or 0 if it is invalid or incomplete (ids keep their marker bit)
+void implement_vint_decode(FILE *f) {
+    print_line(f, 0, "size_t vint_decode(const %s *buf, size_t len, uint64_t *value, bool keep_marker) {", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    if (len == 0 || buf[0] == 0) return 0;");
+    // most ids and sizes of a Cluster are one or two bytes, they need neither the clz nor the wide load
+    print_line(f, 0, "    uint8_t b = buf[0];");
+    print_line(f, 0, "    if (b >= 0x40) {");
+    print_line(f, 0, "        if (b & 0x80) {");
+    print_line(f, 0, "            *value = keep_marker ? b : b & 0x7F;");
+    print_line(f, 0, "            return 1;");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "        if (len < 2) return 0;");
+    print_line(f, 0, "        *value = (uint64_t) (keep_marker ? b : b & 0x3F) << 8 | buf[1];");
+    print_line(f, 0, "        return 2;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    size_t width = vint_length(b);");
+    print_line(f, 0, "    if (width > len) return 0;");
+    print_line(f, 0, "    uint64_t v = load_be(buf, len, width);");
+    print_line(f, 0, "    if (!keep_marker) v &= ((uint64_t) 1 << (7*width)) - 1;");
+    print_line(f, 0, "    *value = v;");
+    print_line(f, 0, "    return width;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // a size with all value bits set is reserved for elements of unknown size (live streams)
+    print_line(f, 0, "bool size_is_unknown(uint64_t size, size_t width) {");
+    print_line(f, 0, "    return size == ((uint64_t) 1 << (7*width)) - 1;");
+    print_line(f, 0, "}");
+}
+
+// One bitset of elements per DocType, the first one (DOCTYPE_ANY) has the elements of all of them.
+void implement_doctype_table(FILE *f) {
+    size_t doctype = find_element("\\EBML\\DocType");
+    assert(doctype != NO_ELEMENT);
+    print_line(f, 0, "#define ELEMENT_DOCTYPE %zu", element_slot[doctype]);
+    print_line(f, 0, "static const char *const doctype_names[%s_DOCTYPE_COUNT] = {", PREFIX_CAPS.cstr);
+    print_line(f, 1, "\"\",");
+    for (size_t t=0; t<doctype_count; t++) {
+        print_line(f, 1, "\"%s\",", doctype_names[t].cstr);
+    }
+    print_line(f, 0, "};");
+    fprintf(f, "\n");
+    print_line(f, 0, "static const uint64_t doctype_elements[%s_DOCTYPE_COUNT][%zu] = {", PREFIX_CAPS.cstr, element_bitset_words());
+    for (size_t t=0; t<=doctype_count; t++) {
+        print_line(f, 1, "{ // %s", t == 0 ? "any" : doctype_names[t-1].cstr);
+        for (size_t w=0; w<element_bitset_words(); w++) {
+            uint64_t bits = 0;
+            for (size_t slot=64*w; slot<element_count && slot<64*(w+1); slot++) {
+                if (t == 0 || (element_list[slot_element[slot]].doctypes >> (t-1)) & 1) bits |= (uint64_t) 1 << (slot % 64);
+            }
+            print_line(f, 2, "0x%016lX,", bits);
+        }
+        print_line(f, 1, "},");
+    }
+    print_line(f, 0, "};");
+}
+
+// every per element table is indexed by the slot of the element in the perfect hash, the hot ones come first
+void implement_element_table(FILE *f) {
+    print_line(f, 0, "#define ELEMENT_COUNT %zu", element_count);
+    print_line(f, 0, "#define ELEMENT_BUCKET_COUNT %zu", hash_bucket_count);
+    print_line(f, 0, "#define ELEMENT_NO_PARENT -1");
+    print_line(f, 0, "#define ELEMENT_FLAG_UNKNOWN_SIZE %d", ELEMENT_FLAG_UNKNOWN_SIZE);
+    print_line(f, 0, "#define ELEMENT_FLAG_RECURSIVE    %d", ELEMENT_FLAG_RECURSIVE);
+    print_line(f, 0, "#define ELEMENT_FLAG_GLOBAL       %d", ELEMENT_FLAG_GLOBAL);
+    fprintf(f, "\n");
+    uint32_t max_displacement = 0;
+    for (size_t b=0; b<hash_bucket_count; b++) {
+        if (hash_displacement[b] > max_displacement) max_displacement = hash_displacement[b];
+    }
+    print_line(f, 0, "static const %s element_displacement[ELEMENT_BUCKET_COUNT] = {", uint_type_for(max_displacement));
+    for (size_t b=0; b<hash_bucket_count; b++) {
+        print_line(f, 1, "%u,", hash_displacement[b]);
+    }
+    print_line(f, 0, "};");
+    fprintf(f, "\n");
+    uint64_t max_id = 0;
     for (size_t i=0; i<element_count; i++) {
-        print_line(f, 2, "case 0x%lX: return %d;", element_list[i].id, element_list[i].type);
+        if (element_list[i].id > max_id) max_id = element_list[i].id;
     }
-    print_line(f, 0, "    }");
-    print_line(f, 0, "    return -1;");
+    print_line(f, 0, "static const %s element_ids[ELEMENT_COUNT] = {", uint_type_for(max_id));
+    for (size_t slot=0; slot<element_count; slot++) {
+        EBML_Element elem = element_list[slot_element[slot]];
+        print_line(f, 1, "0x%lX, // %s", elem.id, elem.name.cstr);
+    }
+    print_line(f, 0, "};");
+    fprintf(f, "\n");
+    print_line(f, 0, "static const uint8_t element_types[ELEMENT_COUNT] = {");
+    for (size_t slot=0; slot<element_count; slot++) {
+        EBML_Type type = element_list[slot_element[slot]].type;
+        print_line(f, 1, "%d, // %s", type, ebml_type_spelling[type]);
+    }
+    print_line(f, 0, "};");
+    fprintf(f, "\n");
+    print_line(f, 0, "static const %s element_parents[ELEMENT_COUNT] = {", element_count > INT16_MAX ? "int32_t" : "int16_t");
+    for (size_t slot=0; slot<element_count; slot++) {
+        size_t parent = element_parent[slot_element[slot]];
+        if (parent == NO_PARENT) {
+            print_line(f, 1, "ELEMENT_NO_PARENT,");
+        } else {
+            print_line(f, 1, "%zu, // %s", element_slot[parent], element_list[parent].name.cstr);
+        }
+    }
+    print_line(f, 0, "};");
+    fprintf(f, "\n");
+    print_line(f, 0, "static const uint8_t element_flags[ELEMENT_COUNT] = {");
+    for (size_t slot=0; slot<element_count; slot++) {
+        print_line(f, 1, "%d,", element_flags(element_list[slot_element[slot]]));
+    }
+    print_line(f, 0, "};");
+    fprintf(f, "\n");
+    if (multiple_doctypes()) {
+        implement_doctype_table(f);
+        fprintf(f, "\n");
+    }
+    // all names are interned into one zero separated pool
+    size_t pool_size = 0;
+    for (size_t slot=0; slot<element_count; slot++) {
+        pool_size += strlen(element_list[slot_element[slot]].name.cstr) + 1;
+    }
+    print_line(f, 0, "static const %s element_name_offsets[ELEMENT_COUNT] = {", uint_type_for(pool_size));
+    size_t offset = 0;
+    for (size_t slot=0; slot<element_count; slot++) {
+        print_line(f, 1, "%zu,", offset);
+        offset += strlen(element_list[slot_element[slot]].name.cstr) + 1;
+    }
+    print_line(f, 0, "};");
+    fprintf(f, "\n");
+    print_line(f, 0, "static const char element_name_pool[] =");
+    for (size_t slot=0; slot<element_count; slot++) {
+        print_line(f, 1, "\"%s\\0\"", element_list[slot_element[slot]].name.cstr);
+    }
+    print_line(f, 0, ";");
+}
+
+void implement_lookup(FILE *f) {
+    print_line(f, 0, "uint64_t hash_id(uint64_t id, uint64_t seed) {");
+    print_line(f, 0, "    uint64_t x = (id ^ (seed * 0xC2B2AE3D27D4EB4F)) * 0x9E3779B97F4A7C15;");
+    print_line(f, 0, "    return x ^ (x >> 32);");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "int lookup(uint64_t id) {");
+    print_line(f, 0, "    uint32_t d = element_displacement[hash_id(id, 0) %% ELEMENT_BUCKET_COUNT];");
+    print_line(f, 0, "    size_t slot = hash_id(id, d) %% ELEMENT_COUNT;");
+    print_line(f, 0, "    return element_ids[slot] == id ? (int) slot : -1;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "const char *element_name(size_t e) {");
+    print_line(f, 0, "    return element_name_pool + element_name_offsets[e];");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // global elements (Void, CRC-32) may appear everywhere, recursive ones also inside of themselves
+    print_line(f, 0, "bool element_is_child(size_t e, size_t parent) {");
+    print_line(f, 0, "    if (element_parents[e] == (int) parent || (element_flags[e] & ELEMENT_FLAG_GLOBAL)) return true;");
+    print_line(f, 0, "    return e == parent && (element_flags[e] & ELEMENT_FLAG_RECURSIVE);");
     print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // the element of `id` if it may be a child of `parent` (-1 at the top level)
+    print_line(f, 0, "int lookup_child(int parent, uint64_t id) {");
+    print_line(f, 0, "    int e = lookup(id);");
+    print_line(f, 0, "    return e >= 0 && (parent < 0 || element_is_child(e, parent)) ? e : -1;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    if (multiple_doctypes()) {
+        print_line(f, 0, "bool doctype_has(size_t doctype, size_t e) {");
+        print_line(f, 0, "    return (doctype_elements[doctype][e / 64] >> (e %% 64)) & 1;");
+        print_line(f, 0, "}");
+        fprintf(f, "\n");
+        // the value of a DocType element, which may be padded with zeros
+        print_line(f, 0, "uint8_t find_doctype(const char *name, size_t length) {");
+        print_line(f, 0, "    while (length > 0 && name[length-1] == '\\0') length--;");
+        print_line(f, 0, "    for (size_t t=1; t<%s_DOCTYPE_COUNT; t++) {", PREFIX_CAPS.cstr);
+        print_line(f, 0, "        if (strlen(doctype_names[t]) == length && memcmp(doctype_names[t], name, length) == 0) return t;");
+        print_line(f, 0, "    }");
+        print_line(f, 0, "    return %s_DOCTYPE_ANY;", PREFIX_CAPS.cstr);
+        print_line(f, 0, "}");
+        fprintf(f, "\n");
+    }
 }
 
-void implement_name(FILE *f) {
-    print_line(f, 0, "char *name(%s *p) {", api_type_name[API_TYPE_PARSER]);
-    print_line(f, 0, "    assert(p->depth > 0);");
-    print_line(f, 0, "    uint64_t id = p->id[p->depth];");
+// the old switch based lookup, only kept to compare against in bench.c
+void write_switch_lookup(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        printf("[ERROR] Could not open file '%s': %s\n", path, strerror(errno));
+        exit(1);
+    }
+    print_line(f, 0, "int lookup_switch(uint64_t id) {");
     print_line(f, 0, "    switch (id) {");
     for (size_t i=0; i<element_count; i++) {
-        print_line(f, 2, "case 0x%lX: return \"%s\";", element_list[i].id, element_list[i].name.cstr);
+        print_line(f, 2, "case 0x%lX: return %zu;", element_list[i].id, element_slot[i]);
     }
     print_line(f, 0, "    }");
-    print_line(f, 0, "    printf(\"[ERROR] got id 0x%%lX\\n\", id);");
-    print_line(f, 0, "    UNREACHABLE(\"name: unknown id\");");
+    print_line(f, 0, "    return -1;");
     print_line(f, 0, "}");
+    fclose(f);
+    printf("[INFO] wrote the switch lookup of %zu elements to '%s'\n", element_count, path);
+}
+
+// Lean parsers collect the values into a buffer they point to (or nowhere), the others into themselves.
+const char *values_prefix(void) {
+    return lean_state ? "p->values->" : "p->";
+}
+
+void begin_values(FILE *f, int depth) {
+    if (lean_state) print_line(f, depth, "if (p->values != NULL) {");
+}
+
+void end_values(FILE *f, int depth) {
+    if (lean_state) print_line(f, depth, "}");
 }
 
 void implement_init_func(FILE *f) {
     print_line(f, 0, "%s {\n", api_func_signature(API_FUNC_INIT).cstr);
+    print_line(f, 1,     "memset(p, 0, sizeof(*p));");
     print_line(f, 1,     "p->offset = -1;");
-    print_line(f, 1,     "p->depth = 0;");
-    print_line(f, 1,     "for (size_t i=0; i<%d; i++) {", MAX_STACK_SIZE);
-    print_line(f, 1,     "    p->id_offset[i] = -1;");
-    print_line(f, 1,     "    p->size_offset[i] = -1;");
-    print_line(f, 1,     "    p->body_offset[i] = -1;");
-    print_line(f, 1,     "}");
-    print_line(f, 1,     "p->body_offset[0] = 0;");
-    print_line(f, 1,     "p->value = 0;");
-    print_line(f, 1,     "p->string_length = 0;");
     print_line(f, 0, "}\n");
 }
 
+// puts the parser right before a child of a level 1 master element, as if everything before `offset` was parsed
+void implement_init_at_func(FILE *f) {
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_INIT_AT).cstr);
+    print_line(f, 0, "    %s(p);", api_func_name(API_FUNC_INIT).cstr);
+    print_line(f, 0, "    if (parent->depth != 1 || parent->type != %d) return %s;", MASTER, api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "    if (offset < parent->body_offset || offset >= parent->body_offset + parent->body_length) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "    p->offset        = offset - 1;");
+    print_line(f, 0, "    p->depth         = 1;");
+    print_line(f, 0, "    p->end[0]        = parent->body_offset + parent->body_length;");
+    print_line(f, 0, "    p->elem[0]       = parent->index;");
+    print_line(f, 0, "    p->unknown_size  = parent->unknown_size ? 1 : 0;");
+    print_line(f, 0, "    p->header_length = HEADER_IN_BODY;");
+    // a lean parser gets its values buffer afterwards, reseed sets it there
+    if (!lean_state) print_line(f, 0, "    p->masters[0]    = parent->index;");
+    // the next byte is the first one of an id
+    print_line(f, 0, "    incdepth(p);");
+    print_line(f, 0, "    return %s;", api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // init_at for a parser in use (after a seek or a resync) that keeps what the user configured
+    print_line(f, 0, "%s reseed(%s *p, const %s *parent, uint64_t offset) {", api_type_name[API_TYPE_RETURN], api_type_name[API_TYPE_PARSER], api_type_name[API_TYPE_ELEMENT]);
+    print_line(f, 0, "    bool skip_binary = p->skip_binary;");
+    print_line(f, 0, "    const %s *filter = p->filter;", api_type_name[API_TYPE_FILTER]);
+    // the EBML header is not read again, the DocType found before still holds
+    if (multiple_doctypes()) print_line(f, 0, "    uint8_t doctype = p->doctype;");
+    if (lean_state) {
+        print_line(f, 0, "    %s *values = p->values;", api_type_name[API_TYPE_VALUES]);
+    } else {
+        print_line(f, 0, "    uint64_t skipped_bytes = p->skipped_bytes;");
+    }
+    print_line(f, 0, "#ifdef %s_VALIDATE", PREFIX_CAPS.cstr);
+    print_line(f, 0, "    %s *validation = p->validation;", api_type_name[API_TYPE_VALIDATION]);
+    print_line(f, 0, "#endif");
+    print_line(f, 0, "#ifdef %s_STATS", PREFIX_CAPS.cstr);
+    print_line(f, 0, "    %s *stats = p->stats;", api_type_name[API_TYPE_STATS]);
+    print_line(f, 0, "#endif");
+    print_line(f, 0, "    %s r = %s(p, parent, offset);", api_type_name[API_TYPE_RETURN], api_func_name(API_FUNC_INIT_AT).cstr);
+    print_line(f, 0, "    p->skip_binary = skip_binary;");
+    print_line(f, 0, "    p->filter = filter;");
+    if (multiple_doctypes()) print_line(f, 0, "    p->doctype = doctype;");
+    if (lean_state) {
+        print_line(f, 0, "    p->values = values;");
+        print_line(f, 0, "    if (values != NULL) {");
+        print_line(f, 0, "        values->masters[0] = parent->index;");
+        print_line(f, 0, "        values->present[0] = 0;");
+        print_line(f, 0, "    }");
+    } else {
+        print_line(f, 0, "    p->skipped_bytes = skipped_bytes;");
+    }
+    print_line(f, 0, "#ifdef %s_VALIDATE", PREFIX_CAPS.cstr);
+    print_line(f, 0, "    p->validation = validation;");
+    print_line(f, 0, "    if (validation != NULL) {");
+    print_line(f, 0, "        memset(validation->seen, 0, sizeof(validation->seen));");
+    print_line(f, 0, "        validation->entered = 0;");
+    print_line(f, 0, "        validation->skipped = false;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "#endif");
+    print_line(f, 0, "#ifdef %s_STATS", PREFIX_CAPS.cstr);
+    print_line(f, 0, "    p->stats = stats;");
+    print_line(f, 0, "#endif");
+    print_line(f, 0, "    return r;");
+    print_line(f, 0, "}");
+}
+
+// a new level starts without any byte of its header
 void implement_incdepth_func(FILE *f) {
-    print_line(f, 0, "void incdepth(%s *p) {", api_type_name[API_TYPE_PARSER]);
-    print_line(f, 0, "    assert(p->depth < %d);", MAX_STACK_SIZE);
+    print_line(f, 0, "bool incdepth(%s *p) {", api_type_name[API_TYPE_PARSER]);
+    print_line(f, 0, "    if (p->depth >= %s_MAX_DEPTH) return false;", PREFIX_CAPS.cstr);
     print_line(f, 0, "    p->depth++;");
-    print_line(f, 0, "    p->id_offset[p->depth]   = -1;");
-    print_line(f, 0, "    p->size_offset[p->depth] = -1;");
-    print_line(f, 0, "    p->body_offset[p->depth] = -1;");
+    print_line(f, 0, "    p->id_length     = 0;");
+    print_line(f, 0, "    p->size_length   = 0;");
+    print_line(f, 0, "    p->header_length = 0;");
+    print_line(f, 0, "    return true;");
     print_line(f, 0, "}");
 }
 
@@ -962,232 +2220,2088 @@ void implement_decdepth_func(FILE *f) {
     print_line(f, 0, "}");
 }
 
+// the header of an element is collected into the end slot of its level
+void implement_header_funcs(FILE *f) {
+    print_line(f, 0, "#define HEADER_IN_BODY 0xFF");
+    // the body of a misplaced element, it is passed over without events
+    print_line(f, 0, "#define HEADER_MISPLACED 0xFE");
+    // ids that are not in the schema are only reported once the header is complete
+    print_line(f, 0, "#define ELEMENT_UNKNOWN ELEMENT_COUNT");
+    fprintf(f, "\n");
+    print_line(f, 0, "void end_id(%s *p) {", api_type_name[API_TYPE_PARSER]);
+    print_line(f, 0, "    size_t d = p->depth - 1;");
+    print_line(f, 0, "    int e = lookup(p->end[d]);");
+    if (multiple_doctypes()) {
+        // the elements of the other DocTypes are as unknown as those of no schema at all
+        print_line(f, 0, "    p->elem[d] = e < 0 || !doctype_has(p->doctype, e) ? ELEMENT_UNKNOWN : e;");
+    } else {
+        print_line(f, 0, "    p->elem[d] = e < 0 ? ELEMENT_UNKNOWN : e;");
+    }
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "%s end_size(%s *p) {", api_type_name[API_TYPE_RETURN], api_type_name[API_TYPE_PARSER]);
+    print_line(f, 0, "    size_t e = p->elem[p->depth-1];");
+    print_line(f, 0, "    if (e == ELEMENT_UNKNOWN) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "    uint64_t size = p->end[p->depth-1];");
+    // an element has to be a child of its parent, unless that has an unknown size and ends with it,
+    // then the element has to be the child of a level above
+    print_line(f, 0, "    bool misplaced = false;");
+    print_line(f, 0, "    for (size_t up=p->depth-1; !misplaced && up > 0 && !element_is_child(e, p->elem[up-1]); up--) {");
+    print_line(f, 0, "        misplaced = !((p->unknown_size >> (up-1)) & 1);");
+    print_line(f, 0, "    }");
+    // An element of unknown size ends with the first id that cannot be its child. There is no separate ELEMEND for it,
+    // just like for a master element that ends together with its last child, the new element moves up instead.
+    print_line(f, 0, "    while (!misplaced && p->depth > 1 && (p->unknown_size & ((%s) 1 << (p->depth-2))) && !element_is_child(e, p->elem[p->depth-2])) {", depth_mask_type());
+    print_line(f, 0, "        VALIDATE(validate_children(p, p->depth-2, p->offset + 1 - p->header_length));");
+    print_line(f, 0, "        decdepth(p);");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    size_t d = p->depth - 1;");
+    print_line(f, 0, "    uint64_t body_offset = p->offset + 1;");
+    print_line(f, 0, "    p->elem[d] = e;");
+    print_line(f, 0, "    if (size_is_unknown(size, p->size_length)) {");
+    print_line(f, 0, "        if (misplaced || !(element_flags[e] & ELEMENT_FLAG_UNKNOWN_SIZE)) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    // it can not go on behind the end of its parent, so it ends there at the latest
+    print_line(f, 0, "        p->unknown_size |= (%s) 1 << d;", depth_mask_type());
+    print_line(f, 0, "        p->end[d] = d > 0 ? p->end[d-1] : body_offset + %s_UNKNOWN_SIZE;", PREFIX_CAPS.cstr);
+    print_line(f, 0, "    } else {");
+    print_line(f, 0, "        p->unknown_size &= ~((%s) 1 << d);", depth_mask_type());
+    print_line(f, 0, "        p->end[d] = body_offset + size;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    if (d > 0 && p->end[d] > p->end[d-1]) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "    if (misplaced) {");
+    print_line(f, 0, "        VALIDATE(violation(p, %s, e, body_offset - p->header_length));", violation_name(VIOLATION_MISPLACED).cstr);
+    print_line(f, 0, "        p->header_length = HEADER_MISPLACED;");
+    print_line(f, 0, "        return %s;", api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    VALIDATE(validate_header(p, e, d));");
+    const char *v = values_prefix();
+    begin_values(f, 1);
+    print_line(f, 1 + lean_state, "uint8_t bit = element_defaults[e].bit;");
+    print_line(f, 1 + lean_state, "if (bit != DEFAULT_NO_BIT && d > 0 && element_parents[e] == (int) p->elem[d-1]) %spresent[d-1] |= (%s) 1 << bit;", v, presence_type());
+    print_line(f, 1 + lean_state, "if (element_types[e] == %d) {", MASTER);
+    print_line(f, 2 + lean_state, "%smasters[d] = e;", v);
+    print_line(f, 2 + lean_state, "%spresent[d] = 0;", v);
+    print_line(f, 1 + lean_state, "}");
+    end_values(f, 1);
+    print_line(f, 0, "    return %s;", api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "%s begin_header(%s *p, %s b) {", api_type_name[API_TYPE_RETURN], api_type_name[API_TYPE_PARSER], api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    if (b == 0) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "    p->id_length     = vint_length(b);");
+    print_line(f, 0, "    p->size_length   = 0;");
+    print_line(f, 0, "    p->header_length = 1;");
+    print_line(f, 0, "    p->end[p->depth-1] = b;");
+    print_line(f, 0, "    if (p->id_length == 1) end_id(p);");
+    print_line(f, 0, "    return %s;", api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "}");
+}
+
+// STATS(...) is empty without LIBEXAMPLE_STATS, the cycles are only taken with LIBEXAMPLE_STATS_CYCLES
+void implement_stats_funcs(FILE *f) {
+    print_line(f, 0, "#ifdef %s_STATS", PREFIX_CAPS.cstr);
+    print_line(f, 0, "#define STATS(...) do { if (p->stats != NULL) { __VA_ARGS__; } } while (0)");
+    fprintf(f, "\n");
+    print_line(f, 0, "void stats_element(%s *s, size_t e, size_t header_length, uint64_t body_length, size_t depth) {", api_type_name[API_TYPE_STATS]);
+    print_line(f, 0, "    s->elements[e].count++;");
+    print_line(f, 0, "    s->elements[e].header_bytes += header_length;");
+    print_line(f, 0, "    s->elements[e].body_bytes += body_length;");
+    print_line(f, 0, "    if (depth > s->elements[e].max_depth) s->elements[e].max_depth = depth;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "#ifdef %s_STATS_CYCLES", PREFIX_CAPS.cstr);
+    print_line(f, 0, "#if defined(__x86_64__) || defined(__i386__)");
+    print_line(f, 0, "#include <x86intrin.h>");
+    print_line(f, 0, "#define stats_clock() __rdtsc()");
+    print_line(f, 0, "#else");
+    print_line(f, 0, "#error \"%s_STATS_CYCLES needs rdtsc\"", PREFIX_CAPS.cstr);
+    print_line(f, 0, "#endif");
+    fprintf(f, "\n");
+    print_line(f, 0, "void stats_event(%s *s, %s r, uint64_t start) {", api_type_name[API_TYPE_STATS], api_type_name[API_TYPE_RETURN]);
+    print_line(f, 0, "    s->events[r - %s]++;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "    s->cycles[r - %s] += stats_clock() - start;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "}");
+    print_line(f, 0, "#endif");
+    fprintf(f, "\n");
+    // one `key=value` record per line, only for elements that were seen
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_STATS_DUMP).cstr);
+    print_line(f, 0, "    for (size_t e=0; e<ELEMENT_COUNT; e++) {");
+    print_line(f, 0, "        if (s->elements[e].count == 0) continue;");
+    print_line(f, 0, "        fprintf(out, \"element=%%s id=0x%%lX count=%%lu header_bytes=%%lu body_bytes=%%lu skipped_bytes=%%lu max_depth=%%lu\\n\",");
+    print_line(f, 0, "                element_name(e), (uint64_t) element_ids[e], s->elements[e].count, s->elements[e].header_bytes,");
+    print_line(f, 0, "                s->elements[e].body_bytes, s->elements[e].skipped_bytes, s->elements[e].max_depth);");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    static const char *event_names[] = {");
+    for (Api_Return_Value i=0; i<API_RETURN_VALUE_COUNT; i++) {
+        print_line(f, 0, "        [%s - %s] = \"%s\",", api_return_value_name(i).cstr, api_return_value_name(API_RETURN_VALUE_ERROR).cstr, api_return_value_suffix[i]);
+    }
+    print_line(f, 0, "    };");
+    print_line(f, 0, "    for (size_t i=0; i<%d; i++) {", API_RETURN_VALUE_COUNT);
+    print_line(f, 0, "        if (s->events[i] == 0) continue;");
+    print_line(f, 0, "        fprintf(out, \"event=%%s count=%%lu cycles=%%lu\\n\", event_names[i], s->events[i], s->cycles[i]);");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "}");
+    print_line(f, 0, "#else");
+    print_line(f, 0, "#define STATS(...) do {} while (0)");
+    print_line(f, 0, "#endif");
+}
+
+// The bounds of a range as they are compared, as doubles (exact for all integers up to 2^53, the bounds of the schemas are small).
+Short_String value_range_row(EBML_Range r) {
+    double lo = r.type == FLOAT ? r.lo_float : (double) r.lo_uint;
+    double hi = r.type == FLOAT ? r.hi_float : (double) r.hi_uint;
+    return shortf("{%d, %d, %d, %a, %a},", r.kind, r.lo_in, r.hi_in, lo, hi);
+}
+
+// the index of the row of `r` in `rows`, which it is added to if it is not there yet (row 0 is no range at all)
+size_t value_range_index(EBML_Range r, Short_String *rows, size_t *row_count) {
+    if (r.kind == RANGE_NONE) return 0;
+    Short_String row = value_range_row(r);
+    for (size_t i=1; i<*row_count; i++) {
+        if (equal(rows[i], row)) return i;
+    }
+    rows[*row_count] = row;
+    return (*row_count)++;
+}
+
+// VALIDATE(...) is empty without LIBEXAMPLE_VALIDATE, the checks are driven by tables
+void implement_validation_funcs(FILE *f) {
+    print_line(f, 0, "#ifdef %s_VALIDATE", PREFIX_CAPS.cstr);
+    print_line(f, 0, "#define VALIDATE(...) do { if (p->validation != NULL) { __VA_ARGS__; } } while (0)");
+    print_line(f, 0, "#define RANGE_EXACT       %d", RANGE_EXACT);
+    print_line(f, 0, "#define RANGE_EXCLUDED    %d", RANGE_EXCLUDED);
+    print_line(f, 0, "#define RANGE_LOWER_BOUND %d", RANGE_LOWER_BOUND);
+    print_line(f, 0, "#define RANGE_UPPER_BOUND %d", RANGE_UPPER_BOUND);
+    print_line(f, 0, "#define RANGE_UPLOW_BOUND %d", RANGE_UPLOW_BOUND);
+    print_line(f, 0, "#define OCCURS_NONE 0x%X", NO_OCCURS);
+    print_line(f, 0, "#define OCCURS_ONCE 0x%X", OCCURS_ONCE);
+    fprintf(f, "\n");
+    // every range and length of the schema once, the elements refer to them by index
+    Short_String *rows = arena_alloc((2*element_count + 1) * sizeof(*rows));
+    size_t row_count = 1;
+    size_t *value_rows  = arena_alloc(element_count * sizeof(*value_rows));
+    size_t *length_rows = arena_alloc(element_count * sizeof(*length_rows));
+    for (size_t slot=0; slot<element_count; slot++) {
+        EBML_Element elem = element_list[slot_element[slot]];
+        bool number = elem.type == UINTEGER || elem.type == INTEGER || elem.type == DATE || elem.type == FLOAT;
+        value_rows[slot]  = number ? value_range_index(elem.range, rows, &row_count) : 0;
+        length_rows[slot] = elem.type != MASTER ? value_range_index(elem.length, rows, &row_count) : 0;
+    }
+    print_line(f, 0, "typedef struct {");
+    print_line(f, 1,     "uint8_t kind;");
+    print_line(f, 1,     "bool lo_in;");
+    print_line(f, 1,     "bool hi_in;");
+    print_line(f, 1,     "double lo;");
+    print_line(f, 1,     "double hi;");
+    print_line(f, 0, "} value_range_t;");
+    fprintf(f, "\n");
+    print_line(f, 0, "static const value_range_t value_ranges[%zu] = {", row_count);
+    print_line(f, 1, "{0},");
+    for (size_t i=1; i<row_count; i++) print_line(f, 1, "%s", rows[i].cstr);
+    print_line(f, 0, "};");
+    fprintf(f, "\n");
+    // one row per element, so that its checks cost one load
+    print_line(f, 0, "typedef struct {");
+    print_line(f, 1,     "uint64_t required; // the bits of the children that have to be there");
+    print_line(f, 1,     "%s value_range;", uint_type_for(row_count));
+    print_line(f, 1,     "%s length_range;", uint_type_for(row_count));
+    print_line(f, 1,     "uint8_t occurs; // the bit of the element in the `seen` set of its parent (or OCCURS_NONE), with OCCURS_ONCE if it may only be there once");
+    print_line(f, 0, "} element_checks_t;");
+    fprintf(f, "\n");
+    print_line(f, 0, "static const element_checks_t element_checks[ELEMENT_COUNT] = {");
+    for (size_t slot=0; slot<element_count; slot++) {
+        size_t i = slot_element[slot];
+        print_line(f, 1, "{0x%lX, %zu, %zu, 0x%02X}, // %s", element_required[i], value_rows[slot], length_rows[slot], element_occurs[i], element_list[i].name.cstr);
+    }
+    print_line(f, 0, "};");
+    fprintf(f, "\n");
+    print_line(f, 0, "void violation(%s *p, %s v, size_t e, uint64_t offset) {", api_type_name[API_TYPE_PARSER], api_type_name[API_TYPE_VIOLATION]);
+    print_line(f, 0, "    p->validation->violations++;");
+    print_line(f, 0, "    if (p->validation->on_violation != NULL) p->validation->on_violation(p->validation->user, v, element_ids[e], element_name(e), offset);");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "bool range_holds(const value_range_t *r, double x) {");
+    print_line(f, 0, "    switch (r->kind) {");
+    print_line(f, 0, "        case RANGE_EXACT:       return x == r->lo;");
+    print_line(f, 0, "        case RANGE_EXCLUDED:    return x != r->lo;");
+    print_line(f, 0, "        case RANGE_LOWER_BOUND: return r->lo_in ? x >= r->lo : x > r->lo;");
+    print_line(f, 0, "        case RANGE_UPPER_BOUND: return r->hi_in ? x <= r->hi : x < r->hi;");
+    print_line(f, 0, "        case RANGE_UPLOW_BOUND: return (r->lo_in ? x >= r->lo : x > r->lo) && (r->hi_in ? x <= r->hi : x < r->hi);");
+    print_line(f, 0, "        default:                return true;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // only on the slow path, so the children are searched for
+    print_line(f, 0, "void validate_missing(%s *p, size_t parent, uint64_t missing, uint64_t offset) {", api_type_name[API_TYPE_PARSER]);
+    print_line(f, 0, "    for (size_t e=0; e<ELEMENT_COUNT; e++) {");
+    print_line(f, 0, "        uint8_t occurs = element_checks[e].occurs;");
+    print_line(f, 0, "        if (element_parents[e] != (int) parent || occurs == OCCURS_NONE) continue;");
+    print_line(f, 0, "        if ((missing >> (occurs & (OCCURS_ONCE - 1))) & 1) violation(p, %s, e, offset);", violation_name(VIOLATION_MISSING).cstr);
+    print_line(f, 0, "    }");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // the header of element `e` at level `d` is complete
+    print_line(f, 0, "void validate_header(%s *p, size_t e, size_t d) {", api_type_name[API_TYPE_PARSER]);
+    print_line(f, 0, "    %s *v = p->validation;", api_type_name[API_TYPE_VALIDATION]);
+    print_line(f, 0, "    const element_checks_t *c = &element_checks[e];");
+    print_line(f, 0, "    uint64_t header_offset = p->offset + 1 - p->header_length;");
+    print_line(f, 0, "    bool unknown = (p->unknown_size >> d) & 1;");
+    print_line(f, 0, "    uint64_t length = p->end[d] - (p->offset + 1);");
+    print_line(f, 0, "    if (c->length_range != 0 && !unknown && !range_holds(&value_ranges[c->length_range], length)) violation(p, %s, e, header_offset);", violation_name(VIOLATION_LENGTH).cstr);
+    print_line(f, 0, "    uint8_t occurs = c->occurs;");
+    print_line(f, 0, "    if (occurs != OCCURS_NONE && d > 0 && ((v->entered >> (d-1)) & 1) && element_parents[e] == (int) p->elem[d-1]) {");
+    print_line(f, 0, "        uint64_t bit = (uint64_t) 1 << (occurs & (OCCURS_ONCE - 1));");
+    print_line(f, 0, "        if ((occurs & OCCURS_ONCE) && (v->seen[d-1] & bit)) violation(p, %s, e, header_offset);", violation_name(VIOLATION_REPEATED).cstr);
+    print_line(f, 0, "        v->seen[d-1] |= bit;");
+    print_line(f, 0, "    }");
+    // an empty master element has no children at all
+    print_line(f, 0, "    if (c->required != 0 && !unknown && length == 0) validate_missing(p, e, c->required, p->offset + 1);");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "void validate_enter(%s *p, size_t d) {", api_type_name[API_TYPE_PARSER]);
+    print_line(f, 0, "    p->validation->seen[d] = 0;");
+    print_line(f, 0, "    p->validation->entered |= (%s) 1 << d;", depth_mask_type());
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // the master element at level `d` ends at `offset`, if this parser saw it start its children were counted
+    print_line(f, 0, "void validate_children(%s *p, size_t d, uint64_t offset) {", api_type_name[API_TYPE_PARSER]);
+    print_line(f, 0, "    %s *v = p->validation;", api_type_name[API_TYPE_VALIDATION]);
+    print_line(f, 0, "    if (!((v->entered >> d) & 1)) return;");
+    print_line(f, 0, "    v->entered &= ~((%s) 1 << d);", depth_mask_type());
+    print_line(f, 0, "    uint64_t missing = element_checks[p->elem[d]].required & ~v->seen[d];");
+    print_line(f, 0, "    if (missing != 0) validate_missing(p, p->elem[d], missing, offset);");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // the element at level `d` ends, its value is complete if its body was fed to the parser
+    const char *val = values_prefix();
+    print_line(f, 0, "void validate_end(%s *p, size_t d, bool body) {", api_type_name[API_TYPE_PARSER]);
+    print_line(f, 0, "    bool skipped = p->validation->skipped;");
+    print_line(f, 0, "    p->validation->skipped = false;");
+    print_line(f, 0, "    size_t e = p->elem[d];");
+    print_line(f, 0, "    size_t r = element_checks[e].value_range;");
+    print_line(f, 0, "    if (skipped || !body || r == 0) return;");
+    if (lean_state) print_line(f, 0, "    if (p->values == NULL) return;");
+    print_line(f, 0, "    double x;");
+    print_line(f, 0, "    switch (element_types[e]) {");
+    print_line(f, 0, "        case %d: x = %svalue; break;", UINTEGER, val);
+    print_line(f, 0, "        case %d:", INTEGER);
+    print_line(f, 0, "        case %d: x = %sint_value; break;", DATE, val);
+    print_line(f, 0, "        case %d: x = %sfloat_value; break;", FLOAT, val);
+    print_line(f, 0, "        default: return;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    if (!range_holds(&value_ranges[r], x)) violation(p, %s, e, p->this_header_offset);", violation_name(VIOLATION_RANGE).cstr);
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // the elements that end with the stream never see the byte after them, which would end them
+    print_line(f, 0, "void validate_eof(%s *p, bool body) {", api_type_name[API_TYPE_PARSER]);
+    print_line(f, 0, "    if (p->depth == 0) return;");
+    print_line(f, 0, "    uint64_t end = p->offset + 1;");
+    print_line(f, 0, "    if (end == p->end[p->depth-1]) validate_end(p, p->depth-1, body);");
+    print_line(f, 0, "    for (size_t d=p->depth; d-->0;) {");
+    print_line(f, 0, "        if (end == p->end[d] || ((p->unknown_size >> d) & 1)) validate_children(p, d, end);");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "}");
+    print_line(f, 0, "#else");
+    print_line(f, 0, "#define VALIDATE(...) do {} while (0)");
+    print_line(f, 0, "#endif");
+}
+
 void implement_parse_func(FILE *f) {
-    print_line(f, 0, "%s {\n", api_func_signature(API_FUNC_PARSE).cstr);
+    const char *v = values_prefix();
+    print_line(f, 0, "%s parse_byte(%s) {\n", api_type_name[API_TYPE_RETURN], api_func_params(API_FUNC_PARSE).cstr);
     print_line(f, 0, "    p->offset++;");
     print_line(f, 0, "    if (p->depth == 0) {");
     print_line(f, 0, "        incdepth(p);");
-    print_line(f, 0, "        p->id_offset[p->depth]   = p->offset;");
-    print_line(f, 0, "        p->size_offset[p->depth] = p->offset + vint_length(b);");
-    print_line(f, 0, "        p->id[p->depth] = b;");
+    print_line(f, 0, "        return begin_header(p, b);");
     print_line(f, 0, "    }");
-    print_line(f, 0, "    assert(p->depth > 0);");
-    print_line(f, 0, "    assert(p->id_offset[p->depth] < p->size_offset[p->depth]);");
-    print_line(f, 0, "    assert(p->size_offset[p->depth] < p->body_offset[p->depth]);");
-    print_line(f, 0, "    if (p->offset <= p->id_offset[p->depth]) {");
-    print_line(f, 0, "        p->id_offset[p->depth] = p->offset;");
-    print_line(f, 0, "        p->size_offset[p->depth] = p->offset + vint_length(b);");
-    print_line(f, 0, "        p->id[p->depth] = b;");
-    print_line(f, 0, "    } else if (p->offset < p->size_offset[p->depth]) {");
-    print_line(f, 0, "        p->id[p->depth] = (p->id[p->depth] << 8) + b;");
-    print_line(f, 0, "    } else if (p->offset == p->size_offset[p->depth]) {");
-    print_line(f, 0, "        p->body_offset[p->depth] = p->offset + vint_length(b);");
-    print_line(f, 0, "        p->size[p->depth] = drop_first_active_bit(b);");
-    print_line(f, 0, "    } else if (p->offset < p->body_offset[p->depth]) {");
-    print_line(f, 0, "        p->size[p->depth] = (p->size[p->depth] << 8) + b;");
-    print_line(f, 0, "    } else if (p->offset == p->body_offset[p->depth] + p->size[p->depth]) {");
-    print_line(f, 0, "        while (p->offset == p->body_offset[p->depth] + p->size[p->depth]) decdepth(p);");
-    print_line(f, 0, "        if (p->depth > 0 && p->offset > p->body_offset[p->depth] + p->size[p->depth]) {");
-    print_line(f, 0, "            printf(\"[ERROR] depth:       %%zu\\n\", p->depth);");
-    print_line(f, 0, "            printf(\"[ERROR] offset:      %%zu\\n\", p->offset);");
-    print_line(f, 0, "            printf(\"[ERROR] body_offset: %%zu\\n\", p->body_offset[p->depth]);");
-    print_line(f, 0, "            printf(\"[ERROR] size:        %%zu\\n\", p->size[p->depth]);");
-    print_line(f, 0, "            UNIMPLEMENTED(\"jumping out of nesting\");");
+    print_line(f, 0, "    size_t d = p->depth - 1;");
+    print_line(f, 0, "    if (p->id_length == 0) return begin_header(p, b);");
+    print_line(f, 0, "    if (p->header_length < p->id_length) {");
+    print_line(f, 0, "        p->end[d] = (p->end[d] << 8) + b;");
+    print_line(f, 0, "        p->header_length++;");
+    print_line(f, 0, "        if (p->header_length == p->id_length) end_id(p);");
+    print_line(f, 0, "        return %s;", api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    if (p->size_length == 0) {");
+    print_line(f, 0, "        if (b == 0) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "        p->size_length = vint_length(b);");
+    print_line(f, 0, "        p->end[d] = drop_first_active_bit(b);");
+    print_line(f, 0, "        p->header_length++;");
+    print_line(f, 0, "        return p->size_length == 1 ? end_size(p) : %s;", api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    if (p->header_length < p->id_length + p->size_length) {");
+    print_line(f, 0, "        p->end[d] = (p->end[d] << 8) + b;");
+    print_line(f, 0, "        p->header_length++;");
+    print_line(f, 0, "        return p->header_length == p->id_length + p->size_length ? end_size(p) : %s;", api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    if (p->offset == p->end[d]) {");
+    if (multiple_doctypes()) {
+        // the value of the DocType is complete, unless the element was empty or skipped
+        print_line(f, 0, "        if (p->elem[d] == ELEMENT_DOCTYPE && p->header_length == HEADER_IN_BODY) {");
+        begin_values(f, 3);
+        print_line(f, 3 + lean_state, "size_t length = p->end[d] - p->this_header_offset - p->this_header_length;");
+        print_line(f, 3 + lean_state, "if (%sstring_length == length) p->doctype = find_doctype(%sstring_buffer, length);", v, v);
+        end_values(f, 3);
+        print_line(f, 0, "        }");
+    }
+    print_line(f, 0, "        bool misplaced = p->header_length == HEADER_MISPLACED;");
+    print_line(f, 0, "        VALIDATE(validate_end(p, d, p->header_length == HEADER_IN_BODY));");
+    print_line(f, 0, "        decdepth(p);");
+    print_line(f, 0, "        while (p->depth > 0 && p->offset == p->end[p->depth-1]) {");
+    print_line(f, 0, "            VALIDATE(validate_children(p, p->depth-1, p->offset));");
+    print_line(f, 0, "            decdepth(p);");
     print_line(f, 0, "        }");
     print_line(f, 0, "        incdepth(p);");
-    print_line(f, 0, "        p->id_offset[p->depth] = p->offset;");
-    print_line(f, 0, "        p->size_offset[p->depth] = p->offset + vint_length(b);");
-    print_line(f, 0, "        p->id[p->depth] = b;");
-    print_line(f, 0, "        return %s;", api_return_value_name(API_RETURN_VALUE_END).cstr);
-    print_line(f, 0, "    } else if (p->offset == p->body_offset[p->depth]) {");
-    print_line(f, 0, "        int t = type(p);"); 
-    print_line(f, 0, "        if (t>=0) {");
-    print_line(f, 0, "            p->type = t;"); 
-    print_line(f, 0, "        } else {");
-    print_line(f, 0, "            return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
-    print_line(f, 0, "        }");
-    print_line(f, 0, "        p->name = name(p);");
+    print_line(f, 0, "        %s r = begin_header(p, b);", api_type_name[API_TYPE_RETURN]);
+    print_line(f, 0, "        return r == %s && !misplaced ? %s : r;", api_return_value_name(API_RETURN_VALUE_OK).cstr, api_return_value_name(API_RETURN_VALUE_END).cstr);
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    if (p->header_length == HEADER_MISPLACED) return %s;", api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "    if (p->header_length != HEADER_IN_BODY) {");
+    print_line(f, 0, "        size_t e = p->elem[d];");
+    print_line(f, 0, "        uint64_t size = p->end[d] - p->offset;");
     print_line(f, 0, "        p->this_depth = p->depth;");
-    print_line(f, 0, "        switch (p->type) {");
-    print_line(f, 0, "            case %d:", MASTER);
-    print_line(f, 0, "                if (p->size[p->depth] == 0) {");
-    print_line(f, 0, "                    UNIMPLEMENTED(\"zero size master element\");");
-    print_line(f, 0, "                }");
-    print_line(f, 0, "                incdepth(p);");
-    print_line(f, 0, "                p->id_offset[p->depth]   = p->offset;");
-    print_line(f, 0, "                p->size_offset[p->depth] = p->offset + vint_length(b);");
-    print_line(f, 0, "                p->id[p->depth] = b;");
+    print_line(f, 0, "        p->this_header_offset = p->offset - p->header_length;");
+    print_line(f, 0, "        p->this_header_length = p->header_length;");
+    print_line(f, 0, "        p->header_length = HEADER_IN_BODY;");
+    print_line(f, 0, "        STATS(stats_element(p->stats, e, p->this_header_length, (p->unknown_size & ((%s) 1 << d)) ? 0 : size, p->depth));", depth_mask_type());
+    if (!lean_state) {
+        print_line(f, 0, "        p->id = element_ids[e];");
+        print_line(f, 0, "        p->type = element_types[e];");
+        print_line(f, 0, "        p->name = element_name(e);");
+    }
+    // elements outside of the subscriptions are skipped completely, for master elements this means
+    // that we do not descend into them (unless their size is unknown, then only their children are skipped)
+    print_line(f, 0, "        if (p->filter != NULL && !filter_wants(p->filter, e) && !(p->unknown_size & ((%s) 1 << d))) {", depth_mask_type());
+    print_line(f, 0, "            p->skip_bytes = size - 1;");
+    print_line(f, 0, "            STATS(p->stats->elements[e].skipped_bytes += size - 1);");
+    print_line(f, 0, "            VALIDATE(p->validation->skipped = true);");
+    print_line(f, 0, "            return %s;", api_return_value_name(API_RETURN_VALUE_SKIP).cstr);
+    print_line(f, 0, "        }");
+    print_line(f, 0, "        switch (element_types[e]) {");
+    print_line(f, 0, "            case %d: {", MASTER);
+    print_line(f, 0, "                if (!incdepth(p)) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "                VALIDATE(validate_enter(p, d));");
+    print_line(f, 0, "                %s r = begin_header(p, b);", api_type_name[API_TYPE_RETURN]);
+    print_line(f, 0, "                if (r != %s) return r;", api_return_value_name(API_RETURN_VALUE_OK).cstr);
     print_line(f, 0, "                break;");
+    print_line(f, 0, "            }");
     print_line(f, 0, "            case %d:", UINTEGER);
-    print_line(f, 0, "                assert(p->size[p->depth] <= 8);");
-    print_line(f, 0, "                p->value = b;");
+    print_line(f, 0, "                if (size > 8) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    begin_values(f, 4);
+    print_line(f, 4 + lean_state, "%svalue = b;", v);
+    end_values(f, 4);
     print_line(f, 0, "                break;");
     print_line(f, 0, "            case %d:", STRING);
-    print_line(f, 2, "                assert(p->size[p->depth] <= %d);", STRING_BUFFER_SIZE);
-    print_line(f, 0, "                p->string_buffer[0] = b;");
-    print_line(f, 2, "                p->string_length = 1;");
-    print_line(f, 0, "                p->string_buffer[1] = '\\0';");
+    print_line(f, 0, "                if (size >= %d) return %s;", STRING_BUFFER_SIZE, api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    begin_values(f, 4);
+    print_line(f, 4 + lean_state, "%sstring_buffer[0] = b;", v);
+    print_line(f, 4 + lean_state, "%sstring_length = 1;", v);
+    print_line(f, 4 + lean_state, "%sstring_buffer[1] = '\\0';", v);
+    end_values(f, 4);
     print_line(f, 0, "                break;");
     print_line(f, 0, "            case %d:", BINARY);
-    print_line(f, 0, "                break;;");
+    // the first byte of the body is already consumed, the rest can be skipped by the caller
+    print_line(f, 0, "                if (p->skip_binary && size > 1) {");
+    print_line(f, 0, "                    p->skip_bytes = size - 1;");
+    print_line(f, 0, "                    STATS(p->stats->elements[e].skipped_bytes += size - 1);");
+    print_line(f, 0, "                    return %s;", api_return_value_name(API_RETURN_VALUE_SKIP).cstr);
+    print_line(f, 0, "                }");
+    print_line(f, 0, "                break;");
     print_line(f, 0, "            case %d:", UTF_8);
     print_line(f, 0, "                break;");
+    // the bytes of signed integers, dates and floats are collected like those of an uinteger
+    // and converted once the body is complete
+    print_line(f, 0, "            case %d:", INTEGER);
+    print_line(f, 0, "            case %d:", DATE);
     print_line(f, 0, "            case %d:", FLOAT);
-    // TODO: collect the float into a value in the parser struct
+    print_line(f, 0, "                if (!number_length_valid(element_types[e], size)) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    begin_values(f, 4);
+    print_line(f, 4 + lean_state, "%svalue = b;", v);
+    print_line(f, 4 + lean_state, "if (size == 1) finish_number(p);");
+    end_values(f, 4);
     print_line(f, 0, "                break;");
-    print_line(f, 0, "            default:"); 
-    print_line(f, 0, "                printf(\"[ERROR] got type %%zu (%%s)\\n\", p->type, type_as_string[p->type]);");
+    print_line(f, 0, "            default:");
+    print_line(f, 0, "                printf(\"[ERROR] got type %%d (%%s)\\n\", element_types[e], type_as_string[element_types[e]]);");
     print_line(f, 0, "                UNREACHABLE(\"first of body: unknown type\");");
     print_line(f, 0, "        }");
+    begin_values(f, 2);
+    print_line(f, 2 + lean_state, "%svalue_elem = e;", v);
+    end_values(f, 2);
     print_line(f, 0, "        return %s;", api_return_value_name(API_RETURN_VALUE_START).cstr);
-    print_line(f, 0, "    } else if (p->offset < p->body_offset[p->depth] + p->size[p->depth]) {");
-    print_line(f, 0, "        switch (p->type) {");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    if (p->offset < p->end[d]) {");
+    print_line(f, 0, "        switch (element_types[p->elem[d]]) {");
     print_line(f, 0, "            case %d:", UINTEGER);
-    print_line(f, 0, "                p->value = (p->value << 8) + b;");
+    begin_values(f, 4);
+    print_line(f, 4 + lean_state, "%svalue = (%svalue << 8) + b;", v, v);
+    end_values(f, 4);
     print_line(f, 0, "                break;");
-    print_line(f, 0, "            case %d:", STRING);
-    print_line(f, 0, "                p->string_buffer[p->string_length] = b;");
-    print_line(f, 0, "                p->string_length++;");
-    print_line(f, 0, "                p->string_buffer[p->string_length] = '\\0';");
+    print_line(f, 0, "            case %d:", INTEGER);
+    print_line(f, 0, "            case %d:", DATE);
+    print_line(f, 0, "            case %d:", FLOAT);
+    begin_values(f, 4);
+    print_line(f, 4 + lean_state, "%svalue = (%svalue << 8) + b;", v, v);
+    print_line(f, 4 + lean_state, "if (p->offset + 1 == p->end[d]) finish_number(p);");
+    end_values(f, 4);
     print_line(f, 0, "                break;");
-    print_line(f, 0, "            case %d:", BINARY);
+    print_line(f, 0, "            case %d:", STRING);
+    begin_values(f, 4);
+    print_line(f, 4 + lean_state, "%sstring_buffer[%sstring_length] = b;", v, v);
+    print_line(f, 4 + lean_state, "%sstring_length++;", v);
+    print_line(f, 4 + lean_state, "%sstring_buffer[%sstring_length] = '\\0';", v, v);
+    end_values(f, 4);
     print_line(f, 0, "                break;");
-    print_line(f, 0, "            case %d:", UTF_8);
+    // the other types are not collected, masters only get here if their body is fed instead of skipped
+    print_line(f, 0, "            default:");
     print_line(f, 0, "                break;");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "        return %s;", api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "}");
+}
+
+// the byte API only wraps parse_byte, so that it can be timed with LIBEXAMPLE_STATS_CYCLES
+void implement_parse_entry(FILE *f, Api_Func func, const char *inner, const char *args) {
+    print_line(f, 0, "%s {", api_func_signature(func).cstr);
+    print_line(f, 0, "#ifdef %s_STATS_CYCLES", PREFIX_CAPS.cstr);
+    print_line(f, 0, "    uint64_t start = stats_clock();");
+    print_line(f, 0, "    %s r = %s(%s);", api_type_name[API_TYPE_RETURN], inner, args);
+    print_line(f, 0, "    STATS(stats_event(p->stats, r, start));");
+    print_line(f, 0, "    return r;");
+    print_line(f, 0, "#else");
+    print_line(f, 0, "    return %s(%s);", inner, args);
+    print_line(f, 0, "#endif");
+    print_line(f, 0, "}");
+}
+
+void implement_parse_buffer_func(FILE *f) {
+    const char *v = values_prefix();
+    print_line(f, 0, "%s parse_bytes(%s) {", api_type_name[API_TYPE_RETURN], api_func_params(API_FUNC_PARSE_BUFFER).cstr);
+    print_line(f, 0, "    size_t i = 0;");
+    print_line(f, 0, "    while (i < len) {");
+    // the first byte of the id is always consumed by the byte API, the rest of the header
+    // is decoded in one step if it is completely inside the buffer
+    print_line(f, 0, "        if (p->depth > 0 && p->id_length > 0 && p->size_length == 0) {");
+    print_line(f, 0, "            size_t id_rest = p->id_length - p->header_length;");
+    print_line(f, 0, "            uint64_t size;");
+    print_line(f, 0, "            size_t size_length = id_rest < len - i ? vint_decode(buf + i + id_rest, len - i - id_rest, &size, false) : 0;");
+    print_line(f, 0, "            if (size_length > 0) {");
+    print_line(f, 0, "                if (id_rest > 0) {");
+    print_line(f, 0, "                    for (size_t j=0; j<id_rest; j++) p->end[p->depth-1] = (p->end[p->depth-1] << 8) + buf[i+j];");
+    print_line(f, 0, "                    p->offset += id_rest;");
+    print_line(f, 0, "                    i += id_rest;");
+    print_line(f, 0, "                    end_id(p);");
+    print_line(f, 0, "                }");
+    print_line(f, 0, "                p->end[p->depth-1] = size;");
+    print_line(f, 0, "                p->size_length = size_length;");
+    print_line(f, 0, "                p->header_length = p->id_length + size_length;");
+    print_line(f, 0, "                p->offset += size_length;");
+    print_line(f, 0, "                i += size_length;");
+    print_line(f, 0, "                if (end_size(p) != %s) {", api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "                    *consumed = i;");
+    print_line(f, 0, "                    return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "                }");
+    print_line(f, 0, "                continue;");
+    print_line(f, 0, "            }");
+    print_line(f, 0, "        }");
+    // strictly inside the body of a non master element, the first byte went through the byte API
+    print_line(f, 0, "        if (p->depth > 0 && p->header_length == HEADER_IN_BODY && p->offset + 1 < p->end[p->depth-1]) {");
+    print_line(f, 0, "            size_t d = p->depth - 1;");
+    print_line(f, 0, "            size_t n = p->end[d] - (p->offset + 1);");
+    print_line(f, 0, "            if (n > len - i) n = len - i;");
+    if (lean_state) {
+        // without a values buffer nothing is collected, EBML_TYPE_COUNT matches none of the cases
+        print_line(f, 0, "            switch (p->values != NULL ? element_types[p->elem[d]] : %d) {", EBML_TYPE_COUNT);
+    } else {
+        print_line(f, 0, "            switch (element_types[p->elem[d]]) {");
+    }
+    // numbers are at most 8 bytes long and their first byte is already consumed, so the rest is one load
+    print_line(f, 0, "                case %d:", UINTEGER);
+    print_line(f, 0, "                    %svalue = (%svalue << 8*n) | load_be(buf + i, len - i, n);", v, v);
+    print_line(f, 0, "                    break;");
+    print_line(f, 0, "                case %d:", INTEGER);
+    print_line(f, 0, "                case %d:", DATE);
+    print_line(f, 0, "                case %d:", FLOAT);
+    print_line(f, 0, "                    %svalue = (%svalue << 8*n) | load_be(buf + i, len - i, n);", v, v);
+    print_line(f, 0, "                    if (p->offset + n + 1 == p->end[d]) finish_number(p);");
+    print_line(f, 0, "                    break;");
+    print_line(f, 0, "                case %d:", STRING);
+    print_line(f, 0, "                    memcpy(%sstring_buffer + %sstring_length, buf + i, n);", v, v);
+    print_line(f, 0, "                    %sstring_length += n;", v);
+    print_line(f, 0, "                    %sstring_buffer[%sstring_length] = '\\0';", v, v);
+    print_line(f, 0, "                    break;");
+    print_line(f, 0, "                default:");
+    print_line(f, 0, "                    break;");
+    print_line(f, 0, "            }");
+    print_line(f, 0, "            p->offset += n;");
+    print_line(f, 0, "            i += n;");
+    print_line(f, 0, "            continue;");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "        %s r = parse_byte(p, buf[i]);", api_type_name[API_TYPE_RETURN]);
+    print_line(f, 0, "        i++;");
+    print_line(f, 0, "        if (r != %s) {", api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "            *consumed = i;");
+    print_line(f, 0, "            return r;");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    *consumed = i;");
+    print_line(f, 0, "    return %s;", api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "}");
+}
+
+void implement_skip_func(FILE *f) {
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_SKIP).cstr);
+    print_line(f, 0, "    p->offset += p->skip_bytes;");
+    if (!lean_state) print_line(f, 0, "    p->skipped_bytes += p->skip_bytes;");
+    print_line(f, 0, "    p->skip_bytes = 0;");
+    print_line(f, 0, "}");
+}
+
+// only valid until the next ELEMEND, then the level of a leaf element is reused by its sibling
+void implement_current_func(FILE *f) {
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_CURRENT).cstr);
+    print_line(f, 0, "    size_t d = p->this_depth - 1;");
+    print_line(f, 0, "    size_t e = p->elem[d];");
+    print_line(f, 0, "    elem->id            = element_ids[e];");
+    print_line(f, 0, "    elem->index         = e;");
+    print_line(f, 0, "    elem->depth         = p->this_depth;");
+    print_line(f, 0, "    elem->type          = element_types[e];");
+    print_line(f, 0, "    elem->name          = element_name(e);");
+    print_line(f, 0, "    elem->header_offset = p->this_header_offset;");
+    print_line(f, 0, "    elem->body_offset   = p->this_header_offset + p->this_header_length;");
+    print_line(f, 0, "    elem->body          = NULL;");
+    print_line(f, 0, "    elem->body_length   = p->end[d] - elem->body_offset;");
+    print_line(f, 0, "    elem->unknown_size  = (p->unknown_size >> d) & 1;");
+    print_line(f, 0, "}");
+}
+
+// the value of an element in the master around the last ELEMSTART, or its default if it is absent
+void implement_value_or_default_func(FILE *f) {
+    const char *v = values_prefix();
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_VALUE_OR_DEFAULT).cstr);
+    print_line(f, 0, "    int e = lookup(id);");
+    print_line(f, 0, "    if (e < 0 || p->this_depth == 0) return false;");
+    if (lean_state) print_line(f, 0, "    if (p->values == NULL) return false;");
+    print_line(f, 0, "    if ((size_t) e == %svalue_elem && (p->header_length != HEADER_IN_BODY || p->depth != p->this_depth)) {", v);
+    print_line(f, 0, "        switch (element_types[e]) {");
+    print_line(f, 0, "            case %d:", UINTEGER);
+    print_line(f, 0, "                value->value = %svalue;", v);
+    print_line(f, 0, "                return true;");
+    print_line(f, 0, "            case %d:", INTEGER);
+    print_line(f, 0, "            case %d:", DATE);
+    print_line(f, 0, "                value->int_value = %sint_value;", v);
+    print_line(f, 0, "                return true;");
     print_line(f, 0, "            case %d:", FLOAT);
-    print_line(f, 0, "                break;");
+    print_line(f, 0, "                value->float_value = %sfloat_value;", v);
+    print_line(f, 0, "                return true;");
+    print_line(f, 0, "            case %d:", STRING);
+    print_line(f, 0, "                value->string = %sstring_buffer;", v);
+    print_line(f, 0, "                value->string_length = %sstring_length;", v);
+    print_line(f, 0, "                return true;");
+    // the values of the other types are not collected
     print_line(f, 0, "            default:");
-    print_line(f, 0, "                printf(\"[ERROR] got type %%zu (%%s)\\n\", p->type, type_as_string[p->type]);");
-    print_line(f, 0, "                UNREACHABLE(\"inside of body: unknown type\");");
+    print_line(f, 0, "                break;");
     print_line(f, 0, "        }");
-    print_line(f, 0, "    } else {");
-    print_line(f, 0, "        UNIMPLEMENTED(\"offset is bigger than body_offset+size\");");
     print_line(f, 0, "    }");
-    print_line(f, 0, "    return %s;", api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "    uint8_t bit = element_defaults[e].bit;");
+    print_line(f, 0, "    if (bit == DEFAULT_NO_BIT) return false;");
+    print_line(f, 0, "    size_t open = p->depth > p->this_depth ? p->this_depth : p->this_depth - 1;");
+    print_line(f, 0, "    for (size_t d=open; d-->0;) {");
+    print_line(f, 0, "        if ((int) %smasters[d] != element_parents[e]) continue;", v);
+    // an element that was there earlier had its value at its ELEMEND
+    print_line(f, 0, "        if ((%spresent[d] >> bit) & 1) return false;", v);
+    print_line(f, 0, "        *value = default_values[element_defaults[e].value];");
+    print_line(f, 0, "        return true;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    return false;");
     print_line(f, 0, "}");
 }
 
 void implement_eof_func(FILE *f) {
     print_line(f, 0, "%s {", api_func_signature(API_FUNC_EOF).cstr);
     print_line(f, 0, "    UNUSED(p);");
+    print_line(f, 0, "    VALIDATE(validate_eof(p, p->header_length == HEADER_IN_BODY));");
     print_line(f, 0, "    return %s;", api_return_value_name(API_RETURN_VALUE_OK).cstr);
     print_line(f, 0, "}");
 }
 
 void implement_print_func(FILE *f) {
+    const char *v = values_prefix();
     print_line(f, 0, "%s {", api_func_signature(API_FUNC_PRINT).cstr);
     print_line(f, 0, "    printf(\"[INFO] Parser\\n\");");
-    print_line(f, 0, "    printf(\"[INFO]   offset = %%zu\\n\", p->offset);");
-    print_line(f, 0, "    printf(\"[INFO]   depth = %%zu\\n\", p->depth);");
-    print_line(f, 0, "    printf(\"[INFO]   id_offset   = [\");");
-    print_line(f, 0, "    printf(\"%%zu\", p->id_offset[0]);");
-    print_line(f, 0, "    for (size_t i=1; i<=p->depth; i++) {");
-    print_line(f, 0, "        printf(\", %%zu\", p->id_offset[i]);");
+    print_line(f, 0, "    printf(\"[INFO]   offset = %%lu\\n\", p->offset);");
+    print_line(f, 0, "    printf(\"[INFO]   depth = %%d\\n\", p->depth);");
+    print_line(f, 0, "    printf(\"[INFO]   header = %%d of %%d id and %%d size bytes\\n\", p->header_length, p->id_length, p->size_length);");
+    print_line(f, 0, "    printf(\"[INFO]   end  = [\");");
+    print_line(f, 0, "    for (size_t i=0; i<p->depth; i++) {");
+    print_line(f, 0, "        printf(i == 0 ? \"%%lu\" : \", %%lu\", p->end[i]);");
     print_line(f, 0, "    }");
     print_line(f, 0, "    printf(\"]\\n\");");
-    print_line(f, 0, "    printf(\"[INFO]   size_offset = [\");");
-    print_line(f, 0, "    printf(\"%%zu\", p->size_offset[0]);");
-    print_line(f, 0, "    for (size_t i=1; i<=p->depth; i++) {");
-    print_line(f, 0, "        printf(\", %%zu\", p->size_offset[i]);");
+    print_line(f, 0, "    printf(\"[INFO]   elem = [\");");
+    print_line(f, 0, "    for (size_t i=0; i<p->depth; i++) {");
+    print_line(f, 0, "        printf(i == 0 ? \"%%d\" : \", %%d\", (int) p->elem[i]);");
     print_line(f, 0, "    }");
     print_line(f, 0, "    printf(\"]\\n\");");
-    print_line(f, 0, "    printf(\"[INFO]   body_offset = [\");");
-    print_line(f, 0, "    printf(\"%%zu\", p->body_offset[0]);");
-    print_line(f, 0, "    for (size_t i=1; i<=p->depth; i++) {");
-    print_line(f, 0, "        printf(\", %%zu\", p->body_offset[i]);");
+    begin_values(f, 1);
+    print_line(f, 1 + lean_state, "printf(\"[INFO]   value = %%lu\\n\", %svalue);", v);
+    print_line(f, 1 + lean_state, "%sstring_buffer[%sstring_length] = '\\0';", v, v);
+    print_line(f, 1 + lean_state, "printf(\"[INFO]   string = '%%s'\\n\", %sstring_buffer);", v);
+    end_values(f, 1);
+    print_line(f, 0, "}");
+}
+
+void implement_cursor_init_func(FILE *f) {
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_CURSOR_INIT).cstr);
+    print_line(f, 0, "    cur->data   = data;");
+    print_line(f, 0, "    cur->length = length;");
+    print_line(f, 0, "    cur->offset = 0;");
+    print_line(f, 0, "    cur->depth  = 0;");
+    print_line(f, 0, "    cur->end[0] = length;");
+    print_line(f, 0, "    cur->unknown_size = 0;");
+    if (multiple_doctypes()) print_line(f, 0, "    cur->doctype = %s_DOCTYPE_ANY;", PREFIX_CAPS.cstr);
+    print_line(f, 0, "}");
+}
+
+void implement_next_func(FILE *f) {
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_NEXT).cstr);
+    print_line(f, 0, "    while (cur->depth > 0 && cur->offset >= cur->end[cur->depth]) cur->depth--;");
+    print_line(f, 0, "    if (cur->offset >= cur->length) return %s;", api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "    const %s *b = cur->data + cur->offset;", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    size_t left = cur->end[cur->depth] - cur->offset;");
+    print_line(f, 0, "    uint64_t id;");
+    print_line(f, 0, "    size_t id_length = vint_decode(b, left, &id, true);");
+    print_line(f, 0, "    if (id_length == 0 || id_length > 4) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "    int e = lookup(id);");
+    if (multiple_doctypes()) {
+        print_line(f, 0, "    if (e < 0 || !doctype_has(cur->doctype, e)) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    } else {
+        print_line(f, 0, "    if (e < 0) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    }
+    print_line(f, 0, "    bool misplaced = false;");
+    print_line(f, 0, "    for (size_t up=cur->depth; !misplaced && up > 0 && !element_is_child(e, cur->elem[up]); up--) {");
+    print_line(f, 0, "        misplaced = !((cur->unknown_size >> up) & 1);");
     print_line(f, 0, "    }");
-    print_line(f, 0, "    printf(\"]\\n\");");
-    print_line(f, 0, "    printf(\"[INFO]   id = [\");");
-    print_line(f, 0, "    printf(\"0x%%lX\", p->id[0]);");
-    print_line(f, 0, "    for (size_t i=1; i<=p->depth; i++) {");
-    print_line(f, 0, "        printf(\", 0x%%lX\", p->id[i]);");
+    // elements of unknown size end where their parent ends, so `left` stays the same
+    print_line(f, 0, "    while (!misplaced && cur->depth > 0 && (cur->unknown_size & ((%s) 1 << cur->depth)) && !element_is_child(e, cur->elem[cur->depth])) cur->depth--;", depth_mask_type());
+    print_line(f, 0, "    uint64_t size;");
+    print_line(f, 0, "    size_t size_length = vint_decode(b + id_length, left - id_length, &size, false);");
+    print_line(f, 0, "    if (size_length == 0) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "    int t = element_types[e];");
+    print_line(f, 0, "    bool unknown_size = size_is_unknown(size, size_length);");
+    print_line(f, 0, "    if (unknown_size) {");
+    print_line(f, 0, "        if (misplaced || t != %d || !(element_flags[e] & ELEMENT_FLAG_UNKNOWN_SIZE)) return %s;", MASTER, api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "        size = left - id_length - size_length;");
     print_line(f, 0, "    }");
-    print_line(f, 0, "    printf(\"]\\n\");");
-    print_line(f, 0, "    printf(\"[INFO]   size = [\");");
-    print_line(f, 0, "    printf(\"0x%%lX\", p->size[0]);");
-    print_line(f, 0, "    for (size_t i=1; i<=p->depth; i++) {");
-    print_line(f, 0, "        printf(\", 0x%%lX\", p->size[i]);");
+    print_line(f, 0, "    if (size > left - id_length - size_length) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    // a misplaced element is passed over like the parser does
+    print_line(f, 0, "    if (misplaced) {");
+    print_line(f, 0, "        cur->offset += id_length + size_length + size;");
+    print_line(f, 0, "        return %s(cur, elem);", api_func_name(API_FUNC_NEXT).cstr);
     print_line(f, 0, "    }");
-    print_line(f, 0, "    printf(\"]\\n\");");
-    print_line(f, 0, "    printf(\"[INFO]   value = %%lu\\n\", p->value);");
-    print_line(f, 0, "    p->string_buffer[p->string_length] = '\\0';");
-    print_line(f, 0, "    printf(\"[INFO]   string = '%%s'\\n\", p->string_buffer);");
+    print_line(f, 0, "    elem->id            = id;");
+    print_line(f, 0, "    elem->index         = e;");
+    print_line(f, 0, "    elem->depth         = cur->depth + 1;");
+    print_line(f, 0, "    elem->type          = t;");
+    print_line(f, 0, "    elem->name          = element_name(e);");
+    print_line(f, 0, "    elem->header_offset = cur->offset;");
+    print_line(f, 0, "    elem->body_offset   = cur->offset + id_length + size_length;");
+    print_line(f, 0, "    elem->body          = cur->data + elem->body_offset;");
+    print_line(f, 0, "    elem->body_length   = size;");
+    print_line(f, 0, "    elem->unknown_size  = unknown_size;");
+    if (multiple_doctypes()) print_line(f, 0, "    if (e == ELEMENT_DOCTYPE) cur->doctype = find_doctype((const char *) elem->body, size);");
+    print_line(f, 0, "    if (t == %d) {", MASTER);
+    print_line(f, 0, "        if (cur->depth + 1 >= %s_MAX_DEPTH) return %s;", PREFIX_CAPS.cstr, api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "        cur->depth++;");
+    print_line(f, 0, "        cur->end[cur->depth] = elem->body_offset + size;");
+    print_line(f, 0, "        cur->elem[cur->depth] = e;");
+    print_line(f, 0, "        cur->unknown_size = unknown_size ? cur->unknown_size | ((%s) 1 << cur->depth) : cur->unknown_size & ~((%s) 1 << cur->depth);", depth_mask_type(), depth_mask_type());
+    print_line(f, 0, "        cur->offset = elem->body_offset;");
+    print_line(f, 0, "    } else {");
+    print_line(f, 0, "        cur->offset = elem->body_offset + size;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    return %s;", api_return_value_name(API_RETURN_VALUE_START).cstr);
     print_line(f, 0, "}");
 }
 
-#ifndef UNIT_TESTING
-int main(void) {
-    for (size_t i=0; i<sizeof(default_header)/sizeof(default_header[0]); i++) {
-        append_element(process_element(default_header[i]));
+// decodes numbers from their big endian bytes, for the parser and for complete values in memory
+void implement_read_funcs(FILE *f) {
+    print_line(f, 0, "int64_t sign_extend(uint64_t value, size_t length) {");
+    print_line(f, 0, "    if (length > 0 && length < 8 && (value >> (8*length - 1)) & 1) value |= ~(uint64_t) 0 << (8*length);");
+    print_line(f, 0, "    return (int64_t) value;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "double float_from_bits(uint64_t bits, size_t length) {");
+    print_line(f, 0, "    if (length == 4) {");
+    print_line(f, 0, "        uint32_t bits32 = bits;");
+    print_line(f, 0, "        float value;");
+    print_line(f, 0, "        memcpy(&value, &bits32, 4);");
+    print_line(f, 0, "        return value;");
+    print_line(f, 0, "    } else if (length == 8) {");
+    print_line(f, 0, "        double value;");
+    print_line(f, 0, "        memcpy(&value, &bits, 8);");
+    print_line(f, 0, "        return value;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    return 0;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // a float has 0, 4 or 8 bytes, a date 0 or 8 and a signed integer at most 8
+    print_line(f, 0, "bool number_length_valid(size_t type, uint64_t length) {");
+    print_line(f, 0, "    switch (type) {");
+    print_line(f, 0, "        case %d: return length == 0 || length == 4 || length == 8;", FLOAT);
+    print_line(f, 0, "        case %d: return length == 0 || length == 8;", DATE);
+    print_line(f, 0, "        default: return length <= 8;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "uint64_t read_uint(const %s *b, size_t length) {", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    return load_be(b, length, length);");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "int64_t read_int(const %s *b, size_t length) {", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    return sign_extend(read_uint(b, length), length);");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "double read_float(const %s *b, size_t length) {", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    return float_from_bits(read_uint(b, length), length);");
+    print_line(f, 0, "}");
+}
+
+// The body of a signed integer, date or float is complete and its bytes are in `value`.
+void implement_finish_number_func(FILE *f) {
+    const char *v = values_prefix();
+    print_line(f, 0, "void finish_number(%s *p) {", api_type_name[API_TYPE_PARSER]);
+    print_line(f, 0, "    size_t d = p->depth - 1;");
+    print_line(f, 0, "    size_t length = p->end[d] - p->this_header_offset - p->this_header_length;");
+    print_line(f, 0, "    if (element_types[p->elem[d]] == %d) {", FLOAT);
+    print_line(f, 0, "        %sfloat_value = float_from_bits(%svalue, length);", v, v);
+    print_line(f, 0, "    } else {");
+    print_line(f, 0, "        %sint_value = sign_extend(%svalue, length);", v, v);
+    print_line(f, 0, "    }");
+    print_line(f, 0, "}");
+}
+
+// every default of the schema once, per element its row and its bit in the presence set of its parent
+void implement_default_funcs(FILE *f) {
+    print_line(f, 0, "#define DEFAULT_NO_BIT 0x%X", NO_DEFAULT_BIT);
+    fprintf(f, "\n");
+    Short_String *rows = arena_alloc((element_count + 1) * sizeof(*rows));
+    size_t row_count = 1;
+    size_t *value_rows = arena_alloc(element_count * sizeof(*value_rows));
+    for (size_t i=0; i<element_count; i++) {
+        if (element_default_row[i].cstr[0] == '\0') continue;
+        for (value_rows[i] = 1; value_rows[i] < row_count && !equal(rows[value_rows[i]], element_default_row[i]); value_rows[i]++) {}
+        if (value_rows[i] == row_count) rows[row_count++] = element_default_row[i];
     }
-    for (size_t i=0; i<sizeof(global_elements)/sizeof(global_elements[0]); i++) {
-        append_element(process_element(global_elements[i]));
+    print_line(f, 0, "static const %s default_values[%zu] = {", api_type_name[API_TYPE_DEFAULT], row_count);
+    print_line(f, 1, "{0},");
+    for (size_t i=1; i<row_count; i++) print_line(f, 1, "{%s},", rows[i].cstr);
+    print_line(f, 0, "};");
+    fprintf(f, "\n");
+    size_t *first_child = arena_alloc(element_count * sizeof(*first_child));
+    size_t child_count = 0;
+    for (size_t slot=0; slot<element_count; slot++) {
+        first_child[slot_element[slot]] = child_count;
+        child_count += element_default_children[slot_element[slot]];
     }
-    FILE *schema_file = fopen(SCHEMA_FILE_NAME, "r");
-    if (schema_file == NULL) {
-        printf("[ERROR] Could not open file '%s': %s\n", SCHEMA_FILE_NAME, strerror(errno));
-        exit(1);
+    size_t *children = arena_alloc((child_count + 1) * sizeof(*children));
+    for (size_t i=0; i<element_count; i++) {
+        if (element_default_bit[i] != NO_DEFAULT_BIT) children[first_child[element_parent[i]] + element_default_bit[i]] = i;
+    }
+    // never empty, C has no arrays without elements
+    print_line(f, 0, "static const %s default_children[%zu] = {", element_index_type(), child_count > 0 ? child_count : 1);
+    for (size_t k=0; k<child_count; k++) print_line(f, 1, "%zu, // %s", element_slot[children[k]], element_list[children[k]].name.cstr);
+    if (child_count == 0) print_line(f, 1, "0,");
+    print_line(f, 0, "};");
+    fprintf(f, "\n");
+    print_line(f, 0, "typedef struct {");
+    print_line(f, 1,     "%s value; // the row in `default_values`", uint_type_for(row_count));
+    print_line(f, 1,     "uint8_t bit; // the bit of the element in the presence set of its parent, or DEFAULT_NO_BIT");
+    print_line(f, 1,     "uint8_t child_count;");
+    print_line(f, 1,     "%s first_child;", uint_type_for(child_count));
+    print_line(f, 0, "} element_defaults_t;");
+    fprintf(f, "\n");
+    print_line(f, 0, "static const element_defaults_t element_defaults[ELEMENT_COUNT] = {");
+    for (size_t slot=0; slot<element_count; slot++) {
+        size_t i = slot_element[slot];
+        print_line(f, 1, "{%zu, 0x%02X, %zu, %zu}, // %s", value_rows[i], element_default_bit[i], element_default_children[i], first_child[i], element_list[i].name.cstr);
     }
+    print_line(f, 0, "};");
+    fprintf(f, "\n");
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_DEFAULT).cstr);
+    print_line(f, 0, "    int e = lookup(id);");
+    print_line(f, 0, "    if (e < 0 || element_defaults[e].value == 0) return false;");
+    print_line(f, 0, "    *value = default_values[element_defaults[e].value];");
+    print_line(f, 0, "    return true;");
+    print_line(f, 0, "}");
+}
 
-    yxml_t parser;
-    yxml_init(&parser, xml_parse_buffer, XML_PARSE_BUFSIZE);
-    Pre_EBML_Element new;
-    bool in_element = false;
-    for (int c = fgetc(schema_file); c != EOF; c = fgetc(schema_file)) {
-        yxml_ret_t r = yxml_parse(&parser, c);
-        switch (r) {
-            case YXML_EEOF:  
-            case YXML_EREF:  
-            case YXML_ECLOSE:
-            case YXML_ESTACK:
-            case YXML_ESYN:  
-                UNIMPLEMENTED("parse error handling");
-            case YXML_OK:
+// dispatches to the handlers by their offset in the visitor, with the signature of the element type
+void implement_visit_func(FILE *f) {
+    print_line(f, 0, "static const size_t visitor_offsets[ELEMENT_COUNT] = {");
+    for (size_t slot=0; slot<element_count; slot++) {
+        print_line(f, 1, "offsetof(%s, on_%s),", api_type_name[API_TYPE_VISITOR], c_identifier(element_list[slot_element[slot]].name).cstr);
+    }
+    print_line(f, 0, "};");
+    fprintf(f, "\n");
+    print_line(f, 0, "typedef void (*handler_t)(void);");
+    fprintf(f, "\n");
+    // the master element `parent` ended, `present` are the bits of its children with a default that were there
+    print_line(f, 0, "void visit_defaults(const %s *v, void *user, size_t parent, uint64_t present) {", api_type_name[API_TYPE_VISITOR]);
+    print_line(f, 0, "    const element_defaults_t *d = &element_defaults[parent];");
+    print_line(f, 0, "    for (size_t bit=0; bit<d->child_count; bit++) {");
+    print_line(f, 0, "        if ((present >> bit) & 1) continue;");
+    print_line(f, 0, "        size_t e = default_children[d->first_child + bit];");
+    print_line(f, 0, "        handler_t h = *(const handler_t *) ((const char *) v + visitor_offsets[e]);");
+    print_line(f, 0, "        if (h == NULL) continue;");
+    print_line(f, 0, "        const %s *value = &default_values[element_defaults[e].value];", api_type_name[API_TYPE_DEFAULT]);
+    print_line(f, 0, "        switch (element_types[e]) {");
+    for (EBML_Type t=0; t<EBML_TYPE_COUNT; t++) {
+        switch (t) {
+            case UINTEGER:
+                print_line(f, 0, "            case %d:", t);
+                print_line(f, 0, "                ((void (*)(%s)) h)(user, value->value);", visitor_params(t).cstr);
                 break;
-            case YXML_ELEMSTART:
-                if (strcmp(parser.elem, "element") == 0) {
-                    in_element = true;
-                    init_pre_element(&new);
-                }
+            case INTEGER:
+            case DATE:
+                print_line(f, 0, "            case %d:", t);
+                print_line(f, 0, "                ((void (*)(%s)) h)(user, value->int_value);", visitor_params(t).cstr);
                 break;
-            case YXML_CONTENT:  
+            case FLOAT:
+                print_line(f, 0, "            case %d:", t);
+                print_line(f, 0, "                ((void (*)(%s)) h)(user, value->float_value);", visitor_params(t).cstr);
                 break;
-            case YXML_ELEMEND:
-                if (in_element) {
-                    // printf("[INFO] found element:\n");
-                    // print_pre_element(new);
-                    insert_element(process_element(new));
-                    in_element = false;
-                }
+            case UTF_8:
+            case STRING:
+                print_line(f, 0, "            case %d:", t);
+                print_line(f, 0, "                ((void (*)(%s)) h)(user, value->string, value->string_length);", visitor_params(t).cstr);
                 break;
-            case YXML_ATTRSTART:
+            // never have a default
+            case MASTER:
+            case BINARY:
+                continue;
+            case EBML_TYPE_COUNT:
+                UNREACHABLE("EBML_TYPE_COUNT is not a valid EBML_Type");
+        }
+        print_line(f, 0, "                break;");
+    }
+    print_line(f, 0, "        }");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_VISIT).cstr);
+    print_line(f, 0, "    %s cur;", api_type_name[API_TYPE_CURSOR]);
+    print_line(f, 0, "    %s(&cur, data, length);", api_func_name(API_FUNC_CURSOR_INIT).cstr);
+    print_line(f, 0, "    %s elem;", api_type_name[API_TYPE_ELEMENT]);
+    print_line(f, 0, "    %s r;", api_type_name[API_TYPE_RETURN]);
+    // with `defaults` the master elements that are open (masters[d] is at depth d+1), and which of their children with a default were there
+    print_line(f, 0, "    size_t masters[%s_MAX_DEPTH];", PREFIX_CAPS.cstr);
+    print_line(f, 0, "    uint64_t present[%s_MAX_DEPTH];", PREFIX_CAPS.cstr);
+    print_line(f, 0, "    size_t open = 0;");
+    print_line(f, 0, "    while ((r = %s(&cur, &elem)) == %s) {", api_func_name(API_FUNC_NEXT).cstr, api_return_value_name(API_RETURN_VALUE_START).cstr);
+    print_line(f, 0, "        if (v->defaults) {");
+    // the masters at the depth of this element or deeper ended before it
+    print_line(f, 0, "            while (open >= elem.depth) {");
+    print_line(f, 0, "                open--;");
+    print_line(f, 0, "                visit_defaults(v, user, masters[open], present[open]);");
+    print_line(f, 0, "            }");
+    print_line(f, 0, "            uint8_t bit = element_defaults[elem.index].bit;");
+    print_line(f, 0, "            if (bit != DEFAULT_NO_BIT && open > 0 && element_parents[elem.index] == (int) masters[open-1]) present[open-1] |= (uint64_t) 1 << bit;");
+    print_line(f, 0, "            if (elem.type == %d) {", MASTER);
+    print_line(f, 0, "                masters[open] = elem.index;");
+    print_line(f, 0, "                present[open] = 0;");
+    print_line(f, 0, "                open++;");
+    print_line(f, 0, "            }");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "        handler_t h = *(const handler_t *) ((const char *) v + visitor_offsets[elem.index]);");
+    print_line(f, 0, "        if (h == NULL) continue;");
+    print_line(f, 0, "        switch (elem.type) {");
+    for (EBML_Type t=0; t<EBML_TYPE_COUNT; t++) {
+        print_line(f, 0, "            case %d:", t);
+        switch (t) {
+            case MASTER:
+                print_line(f, 0, "                ((void (*)(%s)) h)(user);", visitor_params(t).cstr);
                 break;
-            case YXML_ATTRVAL:
-                if (in_element) {
-                    if (strcmp(parser.attr, "name") == 0) {
-                        new.name = append(new.name, parser.data);
-                    } else if (strcmp(parser.attr, "path") == 0) {
-                        new.path = append(new.path, parser.data);
-                    } else if (strcmp(parser.attr, "id") == 0) {
-                        new.id = append(new.id, parser.data);
-                    } else if (strcmp(parser.attr, "type") == 0) {
-                        new.type = append(new.type, parser.data);
-                    } else if (strcmp(parser.attr, "range") == 0) {
-                        new.range = append(new.range, parser.data);
-                    }
-                }
+            case UINTEGER:
+                print_line(f, 0, "                ((void (*)(%s)) h)(user, read_uint(elem.body, elem.body_length));", visitor_params(t).cstr);
                 break;
-            case YXML_ATTREND:
+            case INTEGER:
+            case DATE:
+                print_line(f, 0, "                ((void (*)(%s)) h)(user, read_int(elem.body, elem.body_length));", visitor_params(t).cstr);
                 break;
-            case YXML_PISTART:  
-                UNIMPLEMENTED("YXML_PISTART");
+            case FLOAT:
+                print_line(f, 0, "                ((void (*)(%s)) h)(user, read_float(elem.body, elem.body_length));", visitor_params(t).cstr);
                 break;
-            case YXML_PICONTENT:
-                UNIMPLEMENTED("YXML_PICONTENT");
+            case UTF_8:
+            case STRING:
+                print_line(f, 0, "                ((void (*)(%s)) h)(user, (const char *) elem.body, elem.body_length);", visitor_params(t).cstr);
                 break;
-            case YXML_PIEND:    
-                UNIMPLEMENTED("YXML_PIEND");
+            case BINARY:
+                print_line(f, 0, "                ((void (*)(%s)) h)(user, elem.body, elem.body_length);", visitor_params(t).cstr);
                 break;
+            case EBML_TYPE_COUNT:
+                UNREACHABLE("EBML_TYPE_COUNT is not a valid EBML_Type");
+        }
+        print_line(f, 0, "                break;");
+    }
+    print_line(f, 0, "        }");
+    print_line(f, 0, "    }");
+    // the masters that are still open end with the data
+    print_line(f, 0, "    if (r == %s && v->defaults) {", api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "        while (open > 0) {");
+    print_line(f, 0, "            open--;");
+    print_line(f, 0, "            visit_defaults(v, user, masters[open], present[open]);");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    return r;");
+    print_line(f, 0, "}");
+}
+
+void implement_filter_funcs(FILE *f) {
+    print_line(f, 0, "bool filter_wants(const %s *f, size_t e) {", api_type_name[API_TYPE_FILTER]);
+    print_line(f, 0, "    return (f->wanted[e >> 6] >> (e & 63)) & 1;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "void filter_set(%s *f, size_t e) {", api_type_name[API_TYPE_FILTER]);
+    print_line(f, 0, "    f->wanted[e >> 6] |= (uint64_t) 1 << (e & 63);");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_FILTER_INIT).cstr);
+    print_line(f, 0, "    memset(f->wanted, 0, sizeof(f->wanted));");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // the path is resolved one name at a time, a '+' marks a recursive element
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_FILTER_ADD).cstr);
+    print_line(f, 0, "    int target = ELEMENT_NO_PARENT;");
+    print_line(f, 0, "    while (*path != '\\0') {");
+    print_line(f, 0, "        if (*path != '\\\\') return false;");
+    print_line(f, 0, "        path++;");
+    print_line(f, 0, "        if (*path == '+') path++;");
+    print_line(f, 0, "        size_t n = strcspn(path, \"\\\\\");");
+    print_line(f, 0, "        int next = ELEMENT_NO_PARENT;");
+    print_line(f, 0, "        if (target != ELEMENT_NO_PARENT && (element_flags[target] & ELEMENT_FLAG_RECURSIVE) && strncmp(element_name(target), path, n) == 0 && element_name(target)[n] == '\\0') {");
+    print_line(f, 0, "            next = target;");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "        for (int e=0; e<ELEMENT_COUNT && next == ELEMENT_NO_PARENT; e++) {");
+    print_line(f, 0, "            if (element_parents[e] == target && strncmp(element_name(e), path, n) == 0 && element_name(e)[n] == '\\0') next = e;");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "        if (next == ELEMENT_NO_PARENT) return false;");
+    print_line(f, 0, "        target = next;");
+    print_line(f, 0, "        path += n;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    if (target == ELEMENT_NO_PARENT) return false;");
+    print_line(f, 0, "    for (int e=target; e!=ELEMENT_NO_PARENT; e=element_parents[e]) filter_set(f, e);");
+    print_line(f, 0, "    for (int e=0; e<ELEMENT_COUNT; e++) {");
+    print_line(f, 0, "        for (int a=element_parents[e]; a!=ELEMENT_NO_PARENT; a=element_parents[a]) {");
+    print_line(f, 0, "            if (a == target) filter_set(f, e);");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    return true;");
+    print_line(f, 0, "}");
+}
+
+struct {
+    const char *constant;
+    const char *path;
+} seek_elements[] = {
+    {"EBML",                 "\\EBML"},
+    {"SEGMENT",              "\\Segment"},
+    {"SEEK_HEAD",            "\\Segment\\SeekHead"},
+    {"SEEK",                 "\\Segment\\SeekHead\\Seek"},
+    {"SEEK_ID",              "\\Segment\\SeekHead\\Seek\\SeekID"},
+    {"SEEK_POSITION",        "\\Segment\\SeekHead\\Seek\\SeekPosition"},
+    {"INFO",                 "\\Segment\\Info"},
+    {"TIMESTAMP_SCALE",      "\\Segment\\Info\\TimestampScale"},
+    {"CLUSTER",              "\\Segment\\Cluster"},
+    {"CUES",                 "\\Segment\\Cues"},
+    {"CUE_POINT",            "\\Segment\\Cues\\CuePoint"},
+    {"CUE_TIME",             "\\Segment\\Cues\\CuePoint\\CueTime"},
+    {"CUE_TRACK_POSITIONS",  "\\Segment\\Cues\\CuePoint\\CueTrackPositions"},
+    {"CUE_TRACK",            "\\Segment\\Cues\\CuePoint\\CueTrackPositions\\CueTrack"},
+    {"CUE_CLUSTER_POSITION", "\\Segment\\Cues\\CuePoint\\CueTrackPositions\\CueClusterPosition"},
+};
+#define SEEK_ELEMENT_COUNT (sizeof(seek_elements)/sizeof(seek_elements[0]))
+
+// the seek API only exists if the schema describes a matroska like layout
+bool supports_seek(void) {
+    for (size_t i=0; i<SEEK_ELEMENT_COUNT; i++) {
+        if (find_element(seek_elements[i].path) == NO_ELEMENT) return false;
+    }
+    return true;
+}
+
+void implement_seek_funcs(FILE *f) {
+    print_line(f, 0, "enum {");
+    for (size_t i=0; i<SEEK_ELEMENT_COUNT; i++) {
+        print_line(f, 1, "SEEK_ID_%s = 0x%lX,", seek_elements[i].constant, element_list[find_element(seek_elements[i].path)].id);
+    }
+    print_line(f, 0, "};");
+    fprintf(f, "\n");
+    print_line(f, 0, "size_t seek_read_header(const %s *r, uint64_t offset, uint64_t *id, uint64_t *size) {", api_type_name[API_TYPE_READER]);
+    print_line(f, 0, "    %s buf[12];", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    size_t n = r->read(r->user, offset, buf, sizeof(buf));");
+    print_line(f, 0, "    size_t id_length = vint_decode(buf, n, id, true);");
+    print_line(f, 0, "    if (id_length == 0 || id_length > 4) return 0;");
+    print_line(f, 0, "    size_t size_length = vint_decode(buf + id_length, n - id_length, size, false);");
+    print_line(f, 0, "    if (size_length == 0) return 0;");
+    print_line(f, 0, "    if (size_is_unknown(*size, size_length)) *size = %s_UNKNOWN_SIZE;", PREFIX_CAPS.cstr);
+    print_line(f, 0, "    return id_length + size_length;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // the sizes come from the file, a SeekHead, Info or Cues larger than this is taken as broken
+    print_line(f, 0, "#define SEEK_MAX_BODY (16*1024*1024)");
+    print_line(f, 0, "%s *seek_read_body(const %s *r, uint64_t offset, uint64_t length) {", api_type_name[API_TYPE_BYTE], api_type_name[API_TYPE_READER]);
+    print_line(f, 0, "    if (length > SEEK_MAX_BODY) return NULL;");
+    print_line(f, 0, "    %s *body = malloc(length);", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    if (body == NULL) return NULL;");
+    print_line(f, 0, "    if (r->read(r->user, offset, body, length) != length) {");
+    print_line(f, 0, "        free(body);");
+    print_line(f, 0, "        return NULL;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    return body;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "bool seek_find_uint(const %s *body, size_t length, uint64_t id, uint64_t *value) {", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    %s cur;", api_type_name[API_TYPE_CURSOR]);
+    print_line(f, 0, "    %s elem;", api_type_name[API_TYPE_ELEMENT]);
+    print_line(f, 0, "    %s(&cur, body, length);", api_func_name(API_FUNC_CURSOR_INIT).cstr);
+    print_line(f, 0, "    while (%s(&cur, &elem) == %s) {", api_func_name(API_FUNC_NEXT).cstr, api_return_value_name(API_RETURN_VALUE_START).cstr);
+    print_line(f, 0, "        if (elem.depth == 1 && elem.id == id) {");
+    print_line(f, 0, "            *value = read_uint(elem.body, elem.body_length);");
+    print_line(f, 0, "            return true;");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    return false;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "void seek_parse_seek_head(const %s *body, size_t length, uint64_t segment_body, uint64_t *info, uint64_t *cues) {", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    %s cur;", api_type_name[API_TYPE_CURSOR]);
+    print_line(f, 0, "    %s elem;", api_type_name[API_TYPE_ELEMENT]);
+    print_line(f, 0, "    %s(&cur, body, length);", api_func_name(API_FUNC_CURSOR_INIT).cstr);
+    print_line(f, 0, "    while (%s(&cur, &elem) == %s) {", api_func_name(API_FUNC_NEXT).cstr, api_return_value_name(API_RETURN_VALUE_START).cstr);
+    print_line(f, 0, "        if (elem.depth != 1 || elem.id != SEEK_ID_SEEK) continue;");
+    print_line(f, 0, "        uint64_t id, position;");
+    print_line(f, 0, "        if (!seek_find_uint(elem.body, elem.body_length, SEEK_ID_SEEK_ID, &id)) continue;");
+    print_line(f, 0, "        if (!seek_find_uint(elem.body, elem.body_length, SEEK_ID_SEEK_POSITION, &position)) continue;");
+    print_line(f, 0, "        if (id == SEEK_ID_INFO) *info = segment_body + position;");
+    print_line(f, 0, "        if (id == SEEK_ID_CUES) *cues = segment_body + position;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // CuePoints are only hopped over here, their bodies are looked at during the binary search
+    print_line(f, 0, "size_t seek_cue_points(const %s *cues, size_t length, size_t *points) {", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    size_t count = 0;");
+    print_line(f, 0, "    size_t at = 0;");
+    print_line(f, 0, "    while (at < length) {");
+    print_line(f, 0, "        uint64_t id, size;");
+    print_line(f, 0, "        size_t id_length = vint_decode(cues + at, length - at, &id, true);");
+    print_line(f, 0, "        if (id_length == 0) break;");
+    print_line(f, 0, "        size_t size_length = vint_decode(cues + at + id_length, length - at - id_length, &size, false);");
+    print_line(f, 0, "        if (size_length == 0 || size > length - at - id_length - size_length) break;");
+    print_line(f, 0, "        if (id == SEEK_ID_CUE_POINT) {");
+    print_line(f, 0, "            if (points != NULL) points[count] = at;");
+    print_line(f, 0, "            count++;");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "        at += id_length + size_length + size;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    return count;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "uint64_t seek_cue_time(const %s *cues, size_t length, size_t at) {", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    %s cur;", api_type_name[API_TYPE_CURSOR]);
+    print_line(f, 0, "    %s elem;", api_type_name[API_TYPE_ELEMENT]);
+    print_line(f, 0, "    uint64_t time = UINT64_MAX;");
+    print_line(f, 0, "    %s(&cur, cues + at, length - at);", api_func_name(API_FUNC_CURSOR_INIT).cstr);
+    print_line(f, 0, "    if (%s(&cur, &elem) == %s) seek_find_uint(elem.body, elem.body_length, SEEK_ID_CUE_TIME, &time);", api_func_name(API_FUNC_NEXT).cstr, api_return_value_name(API_RETURN_VALUE_START).cstr);
+    print_line(f, 0, "    return time;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "bool seek_cue_cluster(const %s *cues, size_t length, size_t at, uint64_t track, uint64_t *position) {", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    %s cur;", api_type_name[API_TYPE_CURSOR]);
+    print_line(f, 0, "    %s elem;", api_type_name[API_TYPE_ELEMENT]);
+    print_line(f, 0, "    %s(&cur, cues + at, length - at);", api_func_name(API_FUNC_CURSOR_INIT).cstr);
+    print_line(f, 0, "    if (%s(&cur, &elem) != %s) return false;", api_func_name(API_FUNC_NEXT).cstr, api_return_value_name(API_RETURN_VALUE_START).cstr);
+    print_line(f, 0, "    %s(&cur, elem.body, elem.body_length);", api_func_name(API_FUNC_CURSOR_INIT).cstr);
+    print_line(f, 0, "    while (%s(&cur, &elem) == %s) {", api_func_name(API_FUNC_NEXT).cstr, api_return_value_name(API_RETURN_VALUE_START).cstr);
+    print_line(f, 0, "        if (elem.depth != 1 || elem.id != SEEK_ID_CUE_TRACK_POSITIONS) continue;");
+    print_line(f, 0, "        uint64_t cue_track = 0;");
+    print_line(f, 0, "        seek_find_uint(elem.body, elem.body_length, SEEK_ID_CUE_TRACK, &cue_track);");
+    print_line(f, 0, "        if (track != 0 && cue_track != track) continue;");
+    print_line(f, 0, "        if (seek_find_uint(elem.body, elem.body_length, SEEK_ID_CUE_CLUSTER_POSITION, position)) return true;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    return false;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_SEEK_TIME).cstr);
+    print_line(f, 0, "    uint64_t id, size;");
+    print_line(f, 0, "    size_t header_length = seek_read_header(r, 0, &id, &size);");
+    print_line(f, 0, "    if (header_length == 0 || id != SEEK_ID_EBML || size > SEEK_MAX_BODY) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "    uint64_t segment_offset = header_length + size;");
+    print_line(f, 0, "    header_length = seek_read_header(r, segment_offset, &id, &size);");
+    print_line(f, 0, "    if (header_length == 0 || id != SEEK_ID_SEGMENT) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    // a Segment of unknown size (a live or streamed file) runs to the end of the file
+    print_line(f, 0, "    uint64_t segment_end = UINT64_MAX;");
+    print_line(f, 0, "    if (size != %s_UNKNOWN_SIZE) {", PREFIX_CAPS.cstr);
+    print_line(f, 0, "        if (size > UINT64_MAX - segment_offset - header_length) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "        segment_end = segment_offset + header_length + size;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    %s segment = {0};", api_type_name[API_TYPE_ELEMENT]);
+    print_line(f, 0, "    segment.id            = id;");
+    print_line(f, 0, "    segment.index         = lookup(id);");
+    print_line(f, 0, "    segment.depth         = 1;");
+    print_line(f, 0, "    segment.type          = %d;", MASTER);
+    print_line(f, 0, "    segment.name          = element_name(segment.index);");
+    print_line(f, 0, "    segment.header_offset = segment_offset;");
+    print_line(f, 0, "    segment.body_offset   = segment_offset + header_length;");
+    print_line(f, 0, "    segment.body_length   = size;");
+    print_line(f, 0, "    segment.unknown_size  = size == %s_UNKNOWN_SIZE;", PREFIX_CAPS.cstr);
+    fprintf(f, "\n");
+    // the SeekHead points to Info and Cues, without one we hop over the level 1 elements until we found both
+    // (0 is never a valid position inside of the Segment, the EBML header is there)
+    print_line(f, 0, "    uint64_t info = 0;");
+    print_line(f, 0, "    uint64_t cues = 0;");
+    print_line(f, 0, "    uint64_t at = segment.body_offset;");
+    print_line(f, 0, "    while (at < segment_end && (info == 0 || cues == 0)) {");
+    print_line(f, 0, "        header_length = seek_read_header(r, at, &id, &size);");
+    print_line(f, 0, "        if (header_length == 0) break;");
+    print_line(f, 0, "        if (id == SEEK_ID_SEEK_HEAD) {");
+    print_line(f, 0, "            %s *seek_head = seek_read_body(r, at + header_length, size);", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "            if (seek_head == NULL) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "            seek_parse_seek_head(seek_head, size, segment.body_offset, &info, &cues);");
+    print_line(f, 0, "            free(seek_head);");
+    print_line(f, 0, "        } else if (id == SEEK_ID_INFO) {");
+    print_line(f, 0, "            info = at;");
+    print_line(f, 0, "        } else if (id == SEEK_ID_CUES) {");
+    print_line(f, 0, "            cues = at;");
+    print_line(f, 0, "        }");
+    // where a child of unknown size ends is only found by parsing it
+    print_line(f, 0, "        if (size == %s_UNKNOWN_SIZE || header_length > segment_end - at || size > segment_end - at - header_length) break;", PREFIX_CAPS.cstr);
+    print_line(f, 0, "        at += header_length + size;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    if (cues == 0) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    fprintf(f, "\n");
+    print_line(f, 0, "    %s scale = {0};", api_type_name[API_TYPE_DEFAULT]);
+    print_line(f, 0, "    %s(SEEK_ID_TIMESTAMP_SCALE, &scale);", api_func_name(API_FUNC_DEFAULT).cstr);
+    print_line(f, 0, "    uint64_t timestamp_scale = scale.value;");
+    print_line(f, 0, "    if (info != 0 && (header_length = seek_read_header(r, info, &id, &size)) != 0 && id == SEEK_ID_INFO) {");
+    print_line(f, 0, "        %s *body = seek_read_body(r, info + header_length, size);", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "        if (body != NULL) {");
+    print_line(f, 0, "            seek_find_uint(body, size, SEEK_ID_TIMESTAMP_SCALE, &timestamp_scale);");
+    print_line(f, 0, "            free(body);");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    if (timestamp_scale == 0) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "    uint64_t target = timestamp_ns / timestamp_scale;");
+    fprintf(f, "\n");
+    print_line(f, 0, "    header_length = seek_read_header(r, cues, &id, &size);");
+    print_line(f, 0, "    if (header_length == 0 || id != SEEK_ID_CUES) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "    %s *body = seek_read_body(r, cues + header_length, size);", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    if (body == NULL) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "    size_t count = seek_cue_points(body, size, NULL);");
+    print_line(f, 0, "    size_t *points = malloc(count * sizeof(size_t));");
+    print_line(f, 0, "    if (count == 0 || points == NULL) {");
+    print_line(f, 0, "        free(points);");
+    print_line(f, 0, "        free(body);");
+    print_line(f, 0, "        return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    seek_cue_points(body, size, points);");
+    // the last CuePoint at or before the target, or the first one if the target is before all of them
+    print_line(f, 0, "    size_t lo = 0;");
+    print_line(f, 0, "    size_t hi = count;");
+    print_line(f, 0, "    while (hi - lo > 1) {");
+    print_line(f, 0, "        size_t mid = lo + (hi - lo)/2;");
+    print_line(f, 0, "        if (seek_cue_time(body, size, points[mid]) <= target) {");
+    print_line(f, 0, "            lo = mid;");
+    print_line(f, 0, "        } else {");
+    print_line(f, 0, "            hi = mid;");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "    }");
+    // not every CuePoint has to reference the track we are looking for
+    print_line(f, 0, "    uint64_t cluster = 0;");
+    print_line(f, 0, "    bool found = false;");
+    print_line(f, 0, "    for (size_t i=lo+1; i-- > 0 && !found;) {");
+    print_line(f, 0, "        found = seek_cue_cluster(body, size, points[i], track, &cluster);");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    free(points);");
+    print_line(f, 0, "    free(body);");
+    print_line(f, 0, "    if (!found) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    fprintf(f, "\n");
+    print_line(f, 0, "    cluster += segment.body_offset;");
+    print_line(f, 0, "    header_length = seek_read_header(r, cluster, &id, &size);");
+    print_line(f, 0, "    if (header_length == 0 || id != SEEK_ID_CLUSTER) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "    if (reseed(p, &segment, cluster) != %s) return %s;", api_return_value_name(API_RETURN_VALUE_OK).cstr, api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "    *offset = cluster;");
+    print_line(f, 0, "    return %s;", api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "}");
+}
+
+// the header offsets of the children of a level 1 master element, the count can be bigger than `max`
+void implement_scan_children_func(FILE *f) {
+    // the length of the children at the start of `body` of an element `e` of unknown size
+    print_line(f, 0, "uint64_t scan_unknown_size(const %s *body, uint64_t length, size_t e) {", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    uint64_t at = 0;");
+    print_line(f, 0, "    while (at < length) {");
+    print_line(f, 0, "        uint64_t id, size;");
+    print_line(f, 0, "        size_t id_length = vint_decode(body + at, length - at, &id, true);");
+    print_line(f, 0, "        if (id_length == 0) break;");
+    print_line(f, 0, "        if (lookup_child(e, id) < 0) break;");
+    print_line(f, 0, "        size_t size_length = vint_decode(body + at + id_length, length - at - id_length, &size, false);");
+    print_line(f, 0, "        if (size_length == 0 || size > length - at - id_length - size_length) break;");
+    print_line(f, 0, "        at += id_length + size_length + size;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    return at;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_SCAN_CHILDREN).cstr);
+    print_line(f, 0, "    const %s *body = parent->body;", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    size_t count = 0;");
+    print_line(f, 0, "    uint64_t at = 0;");
+    print_line(f, 0, "    while (at < parent->body_length) {");
+    print_line(f, 0, "        uint64_t id, size;");
+    print_line(f, 0, "        size_t id_length = vint_decode(body + at, parent->body_length - at, &id, true);");
+    print_line(f, 0, "        if (id_length == 0) break;");
+    print_line(f, 0, "        size_t size_length = vint_decode(body + at + id_length, parent->body_length - at - id_length, &size, false);");
+    print_line(f, 0, "        if (size_length == 0) break;");
+    print_line(f, 0, "        if (size_is_unknown(size, size_length)) {");
+    print_line(f, 0, "            int e = lookup(id);");
+    print_line(f, 0, "            if (e < 0 || !(element_flags[e] & ELEMENT_FLAG_UNKNOWN_SIZE)) break;");
+    print_line(f, 0, "            uint64_t body_start = at + id_length + size_length;");
+    print_line(f, 0, "            size = scan_unknown_size(body + body_start, parent->body_length - body_start, e);");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "        if (size > parent->body_length - at - id_length - size_length) break;");
+    print_line(f, 0, "        if (count < max) offsets[count] = parent->body_offset + at;");
+    print_line(f, 0, "        count++;");
+    print_line(f, 0, "        at += id_length + size_length + size;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    return count;");
+    print_line(f, 0, "}");
+}
+
+// parses the children found by scan_children on several threads, each with a parser set up by init_at
+void implement_parse_parallel_func(FILE *f) {
+    print_line(f, 0, "#ifdef %s_PARALLEL", PREFIX_CAPS.cstr);
+    print_line(f, 0, "#include <pthread.h>");
+    print_line(f, 0, "#include <stdatomic.h>");
+    fprintf(f, "\n");
+    // the range of units of a worker as `lo << 32 | hi`, the owner takes from the front and thieves from the back
+    print_line(f, 0, "typedef struct {");
+    print_line(f, 0, "    _Atomic uint64_t range;");
+    print_line(f, 0, "    pthread_t thread;");
+    print_line(f, 0, "} parallel_worker_t;");
+    fprintf(f, "\n");
+    print_line(f, 0, "typedef struct {");
+    print_line(f, 0, "    const %s *parent;", api_type_name[API_TYPE_ELEMENT]);
+    print_line(f, 0, "    const uint64_t *offsets;");
+    print_line(f, 0, "    size_t count;");
+    print_line(f, 0, "    parallel_worker_t *workers;");
+    print_line(f, 0, "    size_t worker_count;");
+    print_line(f, 0, "    %s unit;", api_type_name[API_TYPE_UNIT]);
+    print_line(f, 0, "    void *user;");
+    print_line(f, 0, "    atomic_bool failed;");
+    print_line(f, 0, "} parallel_job_t;");
+    fprintf(f, "\n");
+    print_line(f, 0, "typedef struct {");
+    print_line(f, 0, "    parallel_job_t *job;");
+    print_line(f, 0, "    size_t index;");
+    print_line(f, 0, "} parallel_arg_t;");
+    fprintf(f, "\n");
+    print_line(f, 0, "bool parallel_pop(parallel_worker_t *w, size_t *unit) {");
+    print_line(f, 0, "    uint64_t range = atomic_load(&w->range);");
+    print_line(f, 0, "    while ((range >> 32) < (range & 0xFFFFFFFF)) {");
+    print_line(f, 0, "        if (atomic_compare_exchange_weak(&w->range, &range, range + ((uint64_t) 1 << 32))) {");
+    print_line(f, 0, "            *unit = range >> 32;");
+    print_line(f, 0, "            return true;");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    return false;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "bool parallel_steal(parallel_job_t *job, size_t thief, size_t *unit) {");
+    print_line(f, 0, "    for (size_t i=1; i<job->worker_count; i++) {");
+    print_line(f, 0, "        parallel_worker_t *victim = &job->workers[(thief + i) %% job->worker_count];");
+    print_line(f, 0, "        uint64_t range = atomic_load(&victim->range);");
+    print_line(f, 0, "        while ((range >> 32) < (range & 0xFFFFFFFF)) {");
+    print_line(f, 0, "            uint64_t lo = range >> 32;");
+    print_line(f, 0, "            uint64_t hi = range & 0xFFFFFFFF;");
+    print_line(f, 0, "            uint64_t mid = lo + (hi - lo)/2;");
+    print_line(f, 0, "            if (atomic_compare_exchange_weak(&victim->range, &range, (lo << 32) | mid)) {");
+    print_line(f, 0, "                atomic_store(&job->workers[thief].range, ((mid + 1) << 32) | hi);");
+    print_line(f, 0, "                *unit = mid;");
+    print_line(f, 0, "                return true;");
+    print_line(f, 0, "            }");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    return false;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "void *parallel_run(void *arg) {");
+    print_line(f, 0, "    parallel_job_t *job = ((parallel_arg_t *) arg)->job;");
+    print_line(f, 0, "    size_t index = ((parallel_arg_t *) arg)->index;");
+    print_line(f, 0, "    %s *p = malloc(sizeof(%s));", api_type_name[API_TYPE_PARSER], api_type_name[API_TYPE_PARSER]);
+    print_line(f, 0, "    if (p == NULL) {");
+    print_line(f, 0, "        atomic_store(&job->failed, true);");
+    print_line(f, 0, "        return NULL;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    const %s *data = job->parent->body - job->parent->body_offset;", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    uint64_t parent_end = job->parent->body_offset + job->parent->body_length;");
+    print_line(f, 0, "    size_t unit;");
+    print_line(f, 0, "    while (!atomic_load(&job->failed) && (parallel_pop(&job->workers[index], &unit) || parallel_steal(job, index, &unit))) {");
+    print_line(f, 0, "        uint64_t start = job->offsets[unit];");
+    print_line(f, 0, "        uint64_t end = unit + 1 < job->count ? job->offsets[unit + 1] : parent_end;");
+    print_line(f, 0, "        if (%s(p, job->parent, start) != %s || job->unit(job->user, unit, p, data + start, end - start) != %s) {", api_func_name(API_FUNC_INIT_AT).cstr, api_return_value_name(API_RETURN_VALUE_OK).cstr, api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "            atomic_store(&job->failed, true);");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    free(p);");
+    print_line(f, 0, "    return NULL;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_PARSE_PARALLEL).cstr);
+    print_line(f, 0, "    if (threads == 0 || count >= ((uint64_t) 1 << 32)) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "    if (threads > count) threads = count;");
+    print_line(f, 0, "    if (threads == 0) return %s;", api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "    parallel_job_t job = {parent, offsets, count, NULL, threads, unit, user, false};");
+    print_line(f, 0, "    job.workers = malloc(threads * sizeof(parallel_worker_t));");
+    print_line(f, 0, "    parallel_arg_t *args = malloc(threads * sizeof(parallel_arg_t));");
+    print_line(f, 0, "    if (job.workers == NULL || args == NULL) {");
+    print_line(f, 0, "        free(job.workers);");
+    print_line(f, 0, "        free(args);");
+    print_line(f, 0, "        return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "    }");
+    // contiguous ranges, so that every worker mostly walks through memory front to back
+    print_line(f, 0, "    for (size_t i=0; i<threads; i++) {");
+    print_line(f, 0, "        uint64_t lo = count * i / threads;");
+    print_line(f, 0, "        uint64_t hi = count * (i + 1) / threads;");
+    print_line(f, 0, "        atomic_init(&job.workers[i].range, (lo << 32) | hi);");
+    print_line(f, 0, "        args[i].job = &job;");
+    print_line(f, 0, "        args[i].index = i;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    size_t started = 1;");
+    print_line(f, 0, "    for (; started<threads; started++) {");
+    print_line(f, 0, "        if (pthread_create(&job.workers[started].thread, NULL, parallel_run, &args[started]) != 0) break;");
+    print_line(f, 0, "    }");
+    // the calling thread is worker 0, if a thread could not be started the others steal its units
+    print_line(f, 0, "    parallel_run(&args[0]);");
+    print_line(f, 0, "    for (size_t i=1; i<started; i++) pthread_join(job.workers[i].thread, NULL);");
+    print_line(f, 0, "    free(args);");
+    print_line(f, 0, "    free(job.workers);");
+    print_line(f, 0, "    return atomic_load(&job.failed) ? %s : %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr, api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "}");
+    print_line(f, 0, "#endif");
+}
+
+// the first two bytes of the ids of the children of level 1 masters (Cluster, Cues, Tags, ...), which resync looks for
+size_t resync_pairs(uint8_t pairs[][2]) {
+    size_t count = 0;
+    for (size_t i=0; i<element_count; i++) {
+        EBML_Element e = element_list[i];
+        if (e.path.depth != 2 || e.path.global[1] || e.type != MASTER || e.id < 0x100) continue;
+        int shift = 0;
+        while ((e.id >> (shift + 16)) != 0) shift += 8;
+        uint8_t b0 = e.id >> (shift + 8);
+        uint8_t b1 = e.id >> shift;
+        bool known = false;
+        for (size_t j=0; j<count && !known; j++) known = pairs[j][0] == b0 && pairs[j][1] == b1;
+        if (known) continue;
+        pairs[count][0] = b0;
+        pairs[count][1] = b1;
+        count++;
+    }
+    return count;
+}
+
+void implement_resync_simd(FILE *f, const char *guard, const char *header, int width, const char *vector, const char *op) {
+    uint8_t (*pairs)[2] = arena_alloc(element_count * sizeof(*pairs));
+    size_t pair_count = resync_pairs(pairs);
+    uint8_t lo0 = 0xFF, hi0 = 0, lo1 = 0xFF, hi1 = 0;
+    for (size_t i=0; i<pair_count; i++) {
+        if (pairs[i][0] < lo0) lo0 = pairs[i][0];
+        if (pairs[i][0] > hi0) hi0 = pairs[i][0];
+        if (pairs[i][1] < lo1) lo1 = pairs[i][1];
+        if (pairs[i][1] > hi1) hi1 = pairs[i][1];
+    }
+    print_line(f, 0, "#%s !defined(%s_NO_SIMD) && defined(%s)", width == 32 ? "if" : "elif", PREFIX_CAPS.cstr, guard);
+    print_line(f, 0, "#include <%s>", header);
+    print_line(f, 0, "#define RESYNC_VECTOR %d", width);
+    // A range check on both bytes throws out most vectors, only the rest is compared against every pair.
+    print_line(f, 0, "uint32_t resync_filter(const %s *b) {", api_type_name[API_TYPE_BYTE]);
+    if (pair_count == 0) {
+        print_line(f, 0, "    (void) b;");
+        print_line(f, 0, "    return 0;");
+    } else {
+        print_line(f, 0, "    %s v0 = %s_loadu_si%d((const %s *) b);", vector, op, width*8, vector);
+        print_line(f, 0, "    %s v1 = %s_loadu_si%d((const %s *) (b + 1));", vector, op, width*8, vector);
+        print_line(f, 0, "    %s zero = %s_setzero_si%d();", vector, op, width*8);
+        print_line(f, 0, "    %s r0 = %s_cmpeq_epi8(%s_subs_epu8(%s_sub_epi8(v0, %s_set1_epi8((char) 0x%02X)), %s_set1_epi8((char) 0x%02X)), zero);",
+                   vector, op, op, op, op, lo0, op, hi0 - lo0);
+        print_line(f, 0, "    %s r1 = %s_cmpeq_epi8(%s_subs_epu8(%s_sub_epi8(v1, %s_set1_epi8((char) 0x%02X)), %s_set1_epi8((char) 0x%02X)), zero);",
+                   vector, op, op, op, op, lo1, op, hi1 - lo1);
+        print_line(f, 0, "    return (uint32_t) %s_movemask_epi8(%s_and_si%d(r0, r1));", op, op, width*8);
+    }
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "uint32_t resync_mask(const %s *b) {", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    %s v0 = %s_loadu_si%d((const %s *) b);", vector, op, width*8, vector);
+    print_line(f, 0, "    %s v1 = %s_loadu_si%d((const %s *) (b + 1));", vector, op, width*8, vector);
+    print_line(f, 0, "    %s m = %s_setzero_si%d();", vector, op, width*8);
+    for (size_t i=0; i<pair_count; i++) {
+        print_line(f, 0, "    m = %s_or_si%d(m, %s_and_si%d(%s_cmpeq_epi8(v0, %s_set1_epi8((char) 0x%02X)), %s_cmpeq_epi8(v1, %s_set1_epi8((char) 0x%02X))));",
+                   op, width*8, op, width*8, op, op, pairs[i][0], op, op, pairs[i][1]);
+    }
+    print_line(f, 0, "    return (uint32_t) %s_movemask_epi8(m);", op);
+    print_line(f, 0, "}");
+}
+
+void implement_resync_funcs(FILE *f) {
+    uint8_t (*pairs)[2] = arena_alloc(element_count * sizeof(*pairs));
+    size_t pair_count = resync_pairs(pairs);
+    print_line(f, 0, "bool resync_pair(%s b0, %s b1) {", api_type_name[API_TYPE_BYTE], api_type_name[API_TYPE_BYTE]);
+    if (pair_count == 0) {
+        print_line(f, 0, "    (void) b0;");
+        print_line(f, 0, "    (void) b1;");
+        print_line(f, 0, "    return false;");
+    }
+    for (size_t i=0; i<pair_count; i++) {
+        print_line(f, 0, "    %s (b0 == 0x%02X && b1 == 0x%02X)%s", i == 0 ? "return" : "      ||", pairs[i][0], pairs[i][1], i + 1 == pair_count ? ";" : "");
+    }
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "#if defined(__GNUC__) || defined(__clang__)");
+    implement_resync_simd(f, "__AVX2__", "immintrin.h", 32, "__m256i", "_mm256");
+    implement_resync_simd(f, "__SSE2__", "emmintrin.h", 16, "__m128i", "_mm");
+    print_line(f, 0, "#endif");
+    print_line(f, 0, "#endif");
+    fprintf(f, "\n");
+    // the first candidate in data[0..count), data[count..length) is only looked at by the vector loads
+    print_line(f, 0, "size_t resync_scan(const %s *data, size_t count, size_t length) {", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    size_t i = 0;");
+    print_line(f, 0, "#ifdef RESYNC_VECTOR");
+    // four vectors per iteration, so that the common case is a few cheap operations and one branch per 64 or 128 bytes
+    print_line(f, 0, "    for (; i + 4*RESYNC_VECTOR < length && i < count; i += RESYNC_VECTOR) {");
+    print_line(f, 0, "        const %s *b = data + i;", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "        if ((resync_filter(b) | resync_filter(b + RESYNC_VECTOR) | resync_filter(b + 2*RESYNC_VECTOR) | resync_filter(b + 3*RESYNC_VECTOR)) == 0) {");
+    print_line(f, 0, "            i += 3*RESYNC_VECTOR;");
+    print_line(f, 0, "            continue;");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "        uint32_t mask = resync_mask(b);");
+    print_line(f, 0, "        if (mask != 0) {");
+    print_line(f, 0, "            size_t at = i + __builtin_ctz(mask);");
+    print_line(f, 0, "            return at < count ? at : count;");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    for (; i + RESYNC_VECTOR < length && i < count; i += RESYNC_VECTOR) {");
+    print_line(f, 0, "        uint32_t mask = resync_mask(data + i);");
+    print_line(f, 0, "        if (mask != 0) {");
+    print_line(f, 0, "            size_t at = i + __builtin_ctz(mask);");
+    print_line(f, 0, "            return at < count ? at : count;");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "#endif");
+    print_line(f, 0, "    for (; i < count; i++) {");
+    print_line(f, 0, "        if (resync_pair(data[i], data[i + 1])) return i;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    return count;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // Only candidates with this many bytes behind them are checked: id, size and the id of the first child.
+    print_line(f, 0, "#define RESYNC_LOOKAHEAD 16");
+    fprintf(f, "\n");
+    // whether a plausible child of the level 1 element `parent` starts at `data`
+    print_line(f, 0, "bool resync_check(const %s *parent, const %s *data, uint64_t offset) {", api_type_name[API_TYPE_ELEMENT], api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    uint64_t id, size;");
+    print_line(f, 0, "    size_t id_length = vint_decode(data, RESYNC_LOOKAHEAD, &id, true);");
+    print_line(f, 0, "    if (id_length == 0 || id_length > 4) return false;");
+    print_line(f, 0, "    int e = lookup(id);");
+    print_line(f, 0, "    if (e < 0 || element_parents[e] != (int) parent->index) return false;");
+    print_line(f, 0, "    size_t size_length = vint_decode(data + id_length, RESYNC_LOOKAHEAD - id_length, &size, false);");
+    print_line(f, 0, "    if (size_length == 0) return false;");
+    print_line(f, 0, "    if (size_is_unknown(size, size_length)) {");
+    print_line(f, 0, "        if (!(element_flags[e] & ELEMENT_FLAG_UNKNOWN_SIZE)) return false;");
+    print_line(f, 0, "    } else if (offset + id_length + size_length + size > parent->body_offset + parent->body_length) {");
+    print_line(f, 0, "        return false;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    if (element_types[e] != %d || size == 0) return true;", MASTER);
+    print_line(f, 0, "    uint64_t child_id;");
+    print_line(f, 0, "    size_t child_length = vint_decode(data + id_length + size_length, RESYNC_LOOKAHEAD - id_length - size_length, &child_id, true);");
+    print_line(f, 0, "    if (child_length == 0 || child_length > 4) return false;");
+    print_line(f, 0, "    int c = lookup(child_id);");
+    print_line(f, 0, "    return c >= 0 && (element_parents[c] == e || (element_flags[c] & ELEMENT_FLAG_GLOBAL));");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_RESYNC).cstr);
+    print_line(f, 0, "    *skipped = 0;");
+    print_line(f, 0, "    if (p->depth < 2) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "    uint64_t base = p->offset + 1;");
+    // the header of the level 1 element is gone, only the rest of its body matters here
+    print_line(f, 0, "    %s parent = {0};", api_type_name[API_TYPE_ELEMENT]);
+    print_line(f, 0, "    parent.index         = p->elem[0];");
+    print_line(f, 0, "    parent.id            = element_ids[parent.index];");
+    print_line(f, 0, "    parent.depth         = 1;");
+    print_line(f, 0, "    parent.type          = element_types[parent.index];");
+    print_line(f, 0, "    parent.name          = element_name(parent.index);");
+    print_line(f, 0, "    parent.header_offset = base;");
+    print_line(f, 0, "    parent.body_offset   = base;");
+    print_line(f, 0, "    if (base >= p->end[0]) return %s;", api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "    parent.body_length   = p->end[0] - base;");
+    print_line(f, 0, "    parent.unknown_size  = (p->unknown_size & 1) != 0;");
+    print_line(f, 0, "    size_t count = length < RESYNC_LOOKAHEAD ? 0 : length - RESYNC_LOOKAHEAD + 1;");
+    print_line(f, 0, "    size_t at = 0;");
+    print_line(f, 0, "    while ((at += resync_scan(data + at, count - at, length - at)) < count) {");
+    print_line(f, 0, "        if (resync_check(&parent, data + at, base + at)) {");
+    print_line(f, 0, "            if (reseed(p, &parent, base + at) != %s) return %s;", api_return_value_name(API_RETURN_VALUE_OK).cstr, api_return_value_name(API_RETURN_VALUE_ERROR).cstr);
+    print_line(f, 0, "            *skipped = at;");
+    print_line(f, 0, "            return %s;", api_return_value_name(API_RETURN_VALUE_OK).cstr);
+    print_line(f, 0, "        }");
+    print_line(f, 0, "        at++;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    p->offset += count;");
+    print_line(f, 0, "    *skipped = count;");
+    print_line(f, 0, "    return %s;", api_return_value_name(API_RETURN_VALUE_SKIP).cstr);
+    print_line(f, 0, "}");
+}
+
+void declare_mmap_funcs(FILE *f) {
+    print_line(f, 0, "#if %s", POSIX_GUARD);
+    print_line(f, 0, "const %s *%s_mmap_open(const char *path, size_t *length);", api_type_name[API_TYPE_BYTE], PREFIX);
+    print_line(f, 0, "void %s_mmap_close(const %s *data, size_t length);", PREFIX, api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "size_t %s_read_fd(void *user, uint64_t offset, %s *buf, size_t length);", PREFIX, api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "#endif");
+}
+
+void implement_mmap_funcs(FILE *f) {
+    print_line(f, 0, "#if %s", POSIX_GUARD);
+    print_line(f, 0, "#include <fcntl.h>");
+    print_line(f, 0, "#include <unistd.h>");
+    print_line(f, 0, "#include <sys/mman.h>");
+    print_line(f, 0, "#include <sys/stat.h>");
+    fprintf(f, "\n");
+    print_line(f, 0, "const %s *%s_mmap_open(const char *path, size_t *length) {", api_type_name[API_TYPE_BYTE], PREFIX);
+    print_line(f, 0, "    int fd = open(path, O_RDONLY);");
+    print_line(f, 0, "    if (fd < 0) return NULL;");
+    print_line(f, 0, "    struct stat st;");
+    print_line(f, 0, "    if (fstat(fd, &st) < 0 || st.st_size == 0) {");
+    print_line(f, 0, "        close(fd);");
+    print_line(f, 0, "        return NULL;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    int flags = MAP_PRIVATE;");
+    // the file is read front to back, so ask the kernel to fault in everything ahead of time
+    print_line(f, 0, "#ifdef MAP_POPULATE");
+    print_line(f, 0, "    flags |= MAP_POPULATE;");
+    print_line(f, 0, "#endif");
+    print_line(f, 0, "    void *data = mmap(NULL, st.st_size, PROT_READ, flags, fd, 0);");
+    print_line(f, 0, "    close(fd);");
+    print_line(f, 0, "    if (data == MAP_FAILED) return NULL;");
+    print_line(f, 0, "    madvise(data, st.st_size, MADV_SEQUENTIAL);");
+    print_line(f, 0, "    *length = st.st_size;");
+    print_line(f, 0, "    return data;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "void %s_mmap_close(const %s *data, size_t length) {", PREFIX, api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    munmap((void *) data, length);");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // a read function for the reader type, `user` points to a file descriptor
+    print_line(f, 0, "size_t %s_read_fd(void *user, uint64_t offset, %s *buf, size_t length) {", PREFIX, api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    int fd = *(int *) user;");
+    print_line(f, 0, "    size_t done = 0;");
+    print_line(f, 0, "    while (done < length) {");
+    print_line(f, 0, "        ssize_t n = pread(fd, buf + done, length - done, offset + done);");
+    print_line(f, 0, "        if (n <= 0) break;");
+    print_line(f, 0, "        done += n;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    return done;");
+    print_line(f, 0, "}");
+    print_line(f, 0, "#endif");
+}
+
+// the block layout is the one of matroska, so the decoder is only generated if the schema has its blocks
+bool supports_blocks(void) {
+    return find_element("\\Segment\\Cluster\\SimpleBlock") != NO_ELEMENT
+        || find_element("\\Segment\\Cluster\\BlockGroup\\Block") != NO_ELEMENT;
+}
+
+// decodes the track, timecode, flags and lacing of the body of a SimpleBlock or Block
+void implement_block_decode_func(FILE *f) {
+    Short_String ok  = api_return_value_name(API_RETURN_VALUE_OK);
+    Short_String err = api_return_value_name(API_RETURN_VALUE_ERROR);
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_BLOCK_DECODE).cstr);
+    print_line(f, 0, "    uint64_t track;");
+    print_line(f, 0, "    size_t at = vint_decode(data, length, &track, false);");
+    print_line(f, 0, "    if (at == 0 || at + 3 > length) return %s;", err.cstr);
+    print_line(f, 0, "    block->track = track;");
+    print_line(f, 0, "    block->timecode = (int16_t) ((data[at] << 8) | data[at + 1]);");
+    print_line(f, 0, "    block->flags = data[at + 2];");
+    print_line(f, 0, "    block->lacing = (block->flags >> 1) & 3;");
+    print_line(f, 0, "    at += 3;");
+    print_line(f, 0, "    block->header_length = at;");
+    print_line(f, 0, "    block->frame_count = 0;");
+    // without an array only the header is decoded, e.g. from the first bytes of a skipped block
+    print_line(f, 0, "    if (frame_sizes == NULL) return %s;", ok.cstr);
+    print_line(f, 0, "    size_t count = 1;");
+    print_line(f, 0, "    if (block->lacing != %s_LACING_NONE) {", PREFIX_CAPS.cstr);
+    print_line(f, 0, "        if (at >= length) return %s;", err.cstr);
+    print_line(f, 0, "        count = data[at] + 1;");
+    print_line(f, 0, "        at++;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    block->frame_count = count;");
+    print_line(f, 0, "    if (count > max_frames) return %s;", err.cstr);
+    // the sum of all frames but the last, every frame has to fit into what is left so that it cannot wrap
+    print_line(f, 0, "    uint64_t total = 0;");
+    print_line(f, 0, "    switch (block->lacing) {");
+    print_line(f, 0, "        case %s_LACING_XIPH:", PREFIX_CAPS.cstr);
+    print_line(f, 0, "            for (size_t i=0; i<count-1; i++) {");
+    print_line(f, 0, "                uint64_t size = 0;");
+    print_line(f, 0, "                %s b;", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "                do {");
+    print_line(f, 0, "                    if (at >= length) return %s;", err.cstr);
+    print_line(f, 0, "                    b = data[at++];");
+    print_line(f, 0, "                    size += b;");
+    print_line(f, 0, "                } while (b == 255);");
+    print_line(f, 0, "                if (size > length - at - total) return %s;", err.cstr);
+    print_line(f, 0, "                frame_sizes[i] = size;");
+    print_line(f, 0, "                total += size;");
+    print_line(f, 0, "            }");
+    print_line(f, 0, "            break;");
+    print_line(f, 0, "        case %s_LACING_EBML: {", PREFIX_CAPS.cstr);
+    print_line(f, 0, "            uint64_t size = 0;");
+    print_line(f, 0, "            for (size_t i=0; i<count-1; i++) {");
+    print_line(f, 0, "                uint64_t raw;");
+    print_line(f, 0, "                size_t width = vint_decode(data + at, length - at, &raw, false);");
+    print_line(f, 0, "                if (width == 0) return %s;", err.cstr);
+    print_line(f, 0, "                at += width;");
+    // the deltas are stored with a bias of half the range of their width
+    print_line(f, 0, "                int64_t delta = i == 0 ? (int64_t) raw : (int64_t) raw - (((int64_t) 1 << (7*width - 1)) - 1);");
+    print_line(f, 0, "                if (delta < 0 && (uint64_t) -delta > size) return %s;", err.cstr);
+    print_line(f, 0, "                size += delta;");
+    print_line(f, 0, "                if (size > length - at - total) return %s;", err.cstr);
+    print_line(f, 0, "                frame_sizes[i] = size;");
+    print_line(f, 0, "                total += size;");
+    print_line(f, 0, "            }");
+    print_line(f, 0, "            break;");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "        case %s_LACING_FIXED:", PREFIX_CAPS.cstr);
+    print_line(f, 0, "            if ((length - at) %% count != 0) return %s;", err.cstr);
+    print_line(f, 0, "            for (size_t i=0; i<count-1; i++) frame_sizes[i] = (length - at) / count;");
+    print_line(f, 0, "            total = (length - at) - (length - at) / count;");
+    print_line(f, 0, "            break;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    if (total > length - at) return %s;", err.cstr);
+    print_line(f, 0, "    frame_sizes[count-1] = length - at - total;");
+    print_line(f, 0, "    block->header_length = at;");
+    print_line(f, 0, "    return %s;", ok.cstr);
+    print_line(f, 0, "}");
+}
+
+// Big endian numbers and the widths the writer and the serializer give them, always as small as possible.
+void implement_encode_funcs(FILE *f) {
+    print_line(f, 0, "void store_be(%s *buf, uint64_t value, size_t length) {", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    for (size_t i=0; i<length; i++) buf[i] = value >> (8*(length - 1 - i));");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // ids keep their marker, so their width is the number of bytes they need
+    print_line(f, 0, "size_t id_width(uint64_t id) {");
+    print_line(f, 0, "    size_t n = 1;");
+    print_line(f, 0, "    while (n < 4 && (id >> (8*n)) != 0) n++;");
+    print_line(f, 0, "    return n;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // a size with all value bits set means unknown, so it is never the width of a known size
+    print_line(f, 0, "size_t size_width(uint64_t size) {");
+    print_line(f, 0, "    size_t n = 1;");
+    print_line(f, 0, "    while (n < 8 && size >= ((uint64_t) 1 << (7*n)) - 1) n++;");
+    print_line(f, 0, "    return n;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // the parser does not take empty bodies, so numbers have at least one byte
+    print_line(f, 0, "size_t uint_width(uint64_t value) {");
+    print_line(f, 0, "    size_t n = 1;");
+    print_line(f, 0, "    while (n < 8 && (value >> (8*n)) != 0) n++;");
+    print_line(f, 0, "    return n;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "size_t int_width(int64_t value) {");
+    print_line(f, 0, "    size_t n = 1;");
+    print_line(f, 0, "    while (n < 8 && (value < -((int64_t) 1 << (8*n - 1)) || value >= ((int64_t) 1 << (8*n - 1)))) n++;");
+    print_line(f, 0, "    return n;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // 4 bytes if the value is the same as a float
+    print_line(f, 0, "uint64_t float_bits(double value, size_t *length) {");
+    print_line(f, 0, "    float single = (float) value;");
+    print_line(f, 0, "    if ((double) single == value) {");
+    print_line(f, 0, "        uint32_t bits;");
+    print_line(f, 0, "        memcpy(&bits, &single, 4);");
+    print_line(f, 0, "        *length = 4;");
+    print_line(f, 0, "        return bits;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    uint64_t bits;");
+    print_line(f, 0, "    memcpy(&bits, &value, 8);");
+    print_line(f, 0, "    *length = 8;");
+    print_line(f, 0, "    return bits;");
+    print_line(f, 0, "}");
+}
+
+// measures the tree bottom up, then writes every size with its smallest width
+void implement_serialize_funcs(FILE *f) {
+    // the total length of the element or 0 if the tree is invalid
+    print_line(f, 0, "uint64_t measure_node(%s *n, int parent, size_t depth, size_t max_size_length) {", api_type_name[API_TYPE_NODE]);
+    print_line(f, 0, "    int e = lookup_child(parent, n->id);");
+    print_line(f, 0, "    if (e < 0 || depth >= %s_MAX_DEPTH) return 0;", PREFIX_CAPS.cstr);
+    print_line(f, 0, "    uint64_t body = 0;");
+    print_line(f, 0, "    size_t length;");
+    print_line(f, 0, "    switch (element_types[e]) {");
+    print_line(f, 0, "        case %d:", MASTER);
+    print_line(f, 0, "            for (size_t i=0; i<n->child_count; i++) {");
+    print_line(f, 0, "                uint64_t child = measure_node(&n->children[i], e, depth + 1, max_size_length);");
+    print_line(f, 0, "                if (child == 0) return 0;");
+    print_line(f, 0, "                body += child;");
+    print_line(f, 0, "            }");
+    print_line(f, 0, "            break;");
+    print_line(f, 0, "        case %d:", UINTEGER);
+    print_line(f, 0, "            body = uint_width(n->value);");
+    print_line(f, 0, "            break;");
+    print_line(f, 0, "        case %d:", INTEGER);
+    print_line(f, 0, "            body = int_width(n->int_value);");
+    print_line(f, 0, "            break;");
+    print_line(f, 0, "        case %d:", DATE);
+    print_line(f, 0, "            body = 8;");
+    print_line(f, 0, "            break;");
+    print_line(f, 0, "        case %d:", FLOAT);
+    print_line(f, 0, "            float_bits(n->float_value, &length);");
+    print_line(f, 0, "            body = length;");
+    print_line(f, 0, "            break;");
+    print_line(f, 0, "        default:");
+    print_line(f, 0, "            body = n->length;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    if (size_width(body) > max_size_length) return 0;");
+    print_line(f, 0, "    n->body_length = body;");
+    print_line(f, 0, "    return id_width(n->id) + size_width(body) + body;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // the number of bytes written
+    print_line(f, 0, "size_t emit_node(const %s *n, %s *buf) {", api_type_name[API_TYPE_NODE], api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    size_t at = id_width(n->id);");
+    print_line(f, 0, "    store_be(buf, n->id, at);");
+    print_line(f, 0, "    size_t size_length = size_width(n->body_length);");
+    print_line(f, 0, "    store_be(buf + at, n->body_length | ((uint64_t) 1 << (7*size_length)), size_length);");
+    print_line(f, 0, "    at += size_length;");
+    print_line(f, 0, "    size_t length;");
+    print_line(f, 0, "    switch (element_types[lookup(n->id)]) {");
+    print_line(f, 0, "        case %d:", MASTER);
+    print_line(f, 0, "            for (size_t i=0; i<n->child_count; i++) at += emit_node(&n->children[i], buf + at);");
+    print_line(f, 0, "            return at;");
+    print_line(f, 0, "        case %d:", UINTEGER);
+    print_line(f, 0, "            store_be(buf + at, n->value, n->body_length);");
+    print_line(f, 0, "            break;");
+    print_line(f, 0, "        case %d:", INTEGER);
+    print_line(f, 0, "        case %d:", DATE);
+    print_line(f, 0, "            store_be(buf + at, n->int_value, n->body_length);");
+    print_line(f, 0, "            break;");
+    print_line(f, 0, "        case %d:", FLOAT);
+    print_line(f, 0, "            store_be(buf + at, float_bits(n->float_value, &length), n->body_length);");
+    print_line(f, 0, "            break;");
+    print_line(f, 0, "        default:");
+    print_line(f, 0, "            memcpy(buf + at, n->data, n->length);");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    return at + n->body_length;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // writes only if everything fits into `buf`, returns the length of the output either way (0 for an invalid tree)
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_SERIALIZE).cstr);
+    print_line(f, 0, "    size_t max_size_length = 8;");
+    size_t ebml = find_element("\\EBML");
+    size_t max_size_length = find_element("\\EBML\\EBMLMaxSizeLength");
+    if (ebml != NO_ELEMENT && max_size_length != NO_ELEMENT) {
+        // the EBML header may allow less
+        print_line(f, 0, "    for (size_t i=0; i<count; i++) {");
+        print_line(f, 0, "        if (nodes[i].id != 0x%lX) continue;", element_list[ebml].id);
+        print_line(f, 0, "        for (size_t j=0; j<nodes[i].child_count; j++) {");
+        print_line(f, 0, "            if (nodes[i].children[j].id != 0x%lX) continue;", element_list[max_size_length].id);
+        print_line(f, 0, "            max_size_length = nodes[i].children[j].value;");
+        print_line(f, 0, "            if (max_size_length < 1 || max_size_length > 8) return 0;");
+        print_line(f, 0, "        }");
+        print_line(f, 0, "    }");
+    }
+    print_line(f, 0, "    size_t total = 0;");
+    print_line(f, 0, "    for (size_t i=0; i<count; i++) {");
+    print_line(f, 0, "        uint64_t length = measure_node(&nodes[i], -1, 0, max_size_length);");
+    print_line(f, 0, "        if (length == 0) return 0;");
+    print_line(f, 0, "        total += length;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    if (total > capacity) return total;");
+    print_line(f, 0, "    size_t at = 0;");
+    print_line(f, 0, "    for (size_t i=0; i<count; i++) at += emit_node(&nodes[i], buf + at);");
+    print_line(f, 0, "    return total;");
+    print_line(f, 0, "}");
+}
+
+// reserves the size of every master element and patches it in at end_master (with pwrite if it was written out)
+void implement_writer_funcs(FILE *f) {
+    Short_String ok  = api_return_value_name(API_RETURN_VALUE_OK);
+    Short_String err = api_return_value_name(API_RETURN_VALUE_ERROR);
+    print_line(f, 0, "#if %s", POSIX_GUARD);
+    print_line(f, 0, "#include <errno.h>");
+    print_line(f, 0, "#include <unistd.h>");
+    fprintf(f, "\n");
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_WRITER_INIT).cstr);
+    print_line(f, 0, "    memset(w, 0, sizeof(*w));");
+    print_line(f, 0, "    w->buf = buf;");
+    print_line(f, 0, "    w->capacity = capacity;");
+    print_line(f, 0, "    w->fd = fd;");
+    print_line(f, 0, "    w->size_length = 8;");
+    // -1 if the output can not be patched later on
+    print_line(f, 0, "    w->fd_offset = fd < 0 ? -1 : lseek(fd, 0, SEEK_CUR);");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // writes out everything up to now, the bytes in the buffer and the binary payloads in between
+    print_line(f, 0, "bool writer_writev(%s *w) {", api_type_name[API_TYPE_WRITER]);
+    print_line(f, 0, "    if (w->count > w->iov_start) {");
+    print_line(f, 0, "        w->iov[w->iov_count] = (struct iovec) { w->buf + w->iov_start, w->count - w->iov_start };");
+    print_line(f, 0, "        w->iov_count++;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    struct iovec *iov = w->iov;");
+    print_line(f, 0, "    size_t n = w->iov_count;");
+    print_line(f, 0, "    while (n > 0) {");
+    print_line(f, 0, "        ssize_t done = writev(w->fd, iov, n);");
+    print_line(f, 0, "        if (done < 0 && errno == EINTR) continue;");
+    print_line(f, 0, "        if (done < 0) return false;");
+    print_line(f, 0, "        while (n > 0 && (size_t) done >= iov->iov_len) {");
+    print_line(f, 0, "            done -= iov->iov_len;");
+    print_line(f, 0, "            iov++;");
+    print_line(f, 0, "            n--;");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "        if (n > 0) {");
+    print_line(f, 0, "            iov->iov_base = (char *) iov->iov_base + done;");
+    print_line(f, 0, "            iov->iov_len -= done;");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    w->flushed   = w->offset;");
+    print_line(f, 0, "    w->count     = 0;");
+    print_line(f, 0, "    w->iov_start = 0;");
+    print_line(f, 0, "    w->iov_count = 0;");
+    print_line(f, 0, "    return true;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // makes room for `length` more bytes in the buffer
+    print_line(f, 0, "bool writer_reserve(%s *w, size_t length) {", api_type_name[API_TYPE_WRITER]);
+    print_line(f, 0, "    if (w->count + length <= w->capacity) return true;");
+    print_line(f, 0, "    if (w->fd < 0 || !writer_writev(w)) return false;");
+    print_line(f, 0, "    return length <= w->capacity;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // the element index of `id` if it has type `type` and may be written at the current level, -1 otherwise
+    print_line(f, 0, "int writer_element(const %s *w, uint64_t id, int type) {", api_type_name[API_TYPE_WRITER]);
+    print_line(f, 0, "    int e = lookup_child(w->depth == 0 ? -1 : (int) w->elem[w->depth-1], id);");
+    print_line(f, 0, "    return e >= 0 && element_types[e] == type ? e : -1;");
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // the id and the size of an element whose body follows directly
+    print_line(f, 0, "%s writer_header(%s *w, uint64_t id, int type, uint64_t size, size_t reserve) {", api_type_name[API_TYPE_RETURN], api_type_name[API_TYPE_WRITER]);
+    print_line(f, 0, "    if (writer_element(w, id, type) < 0) return %s;", err.cstr);
+    print_line(f, 0, "    size_t id_length = id_width(id);");
+    print_line(f, 0, "    size_t size_length = size_width(size);");
+    print_line(f, 0, "    if (!writer_reserve(w, id_length + size_length + reserve)) return %s;", err.cstr);
+    print_line(f, 0, "    store_be(w->buf + w->count, id, id_length);");
+    print_line(f, 0, "    store_be(w->buf + w->count + id_length, size | ((uint64_t) 1 << (7*size_length)), size_length);");
+    print_line(f, 0, "    w->count  += id_length + size_length;");
+    print_line(f, 0, "    w->offset += id_length + size_length;");
+    print_line(f, 0, "    return %s;", ok.cstr);
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_BEGIN_MASTER).cstr);
+    print_line(f, 0, "    int e = writer_element(w, id, %d);", MASTER);
+    print_line(f, 0, "    if (e < 0 || w->depth == %s_MAX_DEPTH || w->size_length < 1 || w->size_length > 8) return %s;", PREFIX_CAPS.cstr, err.cstr);
+    print_line(f, 0, "    size_t id_length = id_width(id);");
+    print_line(f, 0, "    if (!writer_reserve(w, id_length + w->size_length)) return %s;", err.cstr);
+    print_line(f, 0, "    store_be(w->buf + w->count, id, id_length);");
+    print_line(f, 0, "    store_be(w->buf + w->count + id_length, ((uint64_t) 1 << (7*w->size_length + 1)) - 1, w->size_length);");
+    print_line(f, 0, "    w->size_at[w->depth]     = w->count + id_length;");
+    print_line(f, 0, "    w->size_offset[w->depth] = w->offset + id_length;");
+    print_line(f, 0, "    w->elem[w->depth]        = e;");
+    print_line(f, 0, "    w->depth++;");
+    print_line(f, 0, "    w->count  += id_length + w->size_length;");
+    print_line(f, 0, "    w->offset += id_length + w->size_length;");
+    print_line(f, 0, "    return %s;", ok.cstr);
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_END_MASTER).cstr);
+    print_line(f, 0, "    if (w->depth == 0) return %s;", err.cstr);
+    print_line(f, 0, "    w->depth--;");
+    print_line(f, 0, "    size_t d = w->depth;");
+    print_line(f, 0, "    uint64_t size = w->offset - w->size_offset[d] - w->size_length;");
+    print_line(f, 0, "    if (size >= ((uint64_t) 1 << (7*w->size_length)) - 1) return %s;", err.cstr);
+    print_line(f, 0, "    uint64_t marked = size | ((uint64_t) 1 << (7*w->size_length));");
+    print_line(f, 0, "    if (w->size_offset[d] >= w->flushed) {");
+    print_line(f, 0, "        store_be(w->buf + w->size_at[d], marked, w->size_length);");
+    print_line(f, 0, "        return %s;", ok.cstr);
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    %s patch[8];", api_type_name[API_TYPE_BYTE]);
+    print_line(f, 0, "    store_be(patch, marked, w->size_length);");
+    print_line(f, 0, "    if (w->fd_offset >= 0 && pwrite(w->fd, patch, w->size_length, w->fd_offset + w->size_offset[d]) == (ssize_t) w->size_length) return %s;", ok.cstr);
+    print_line(f, 0, "    return (element_flags[w->elem[d]] & ELEMENT_FLAG_UNKNOWN_SIZE) ? %s : %s;", ok.cstr, err.cstr);
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // the lowest `length` bytes of `bits` as the body
+    print_line(f, 0, "%s writer_number(%s *w, uint64_t id, int type, uint64_t bits, size_t length) {", api_type_name[API_TYPE_RETURN], api_type_name[API_TYPE_WRITER]);
+    print_line(f, 0, "    if (writer_header(w, id, type, length, length) != %s) return %s;", ok.cstr, err.cstr);
+    print_line(f, 0, "    store_be(w->buf + w->count, bits, length);");
+    print_line(f, 0, "    w->count  += length;");
+    print_line(f, 0, "    w->offset += length;");
+    print_line(f, 0, "    return %s;", ok.cstr);
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_WRITE_UINT).cstr);
+    print_line(f, 0, "    return writer_number(w, id, %d, value, uint_width(value));", UINTEGER);
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // dates always have 8 bytes
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_WRITE_INT).cstr);
+    print_line(f, 0, "    int e = lookup(id);");
+    print_line(f, 0, "    if (e >= 0 && element_types[e] == %d) return writer_number(w, id, %d, value, 8);", DATE, DATE);
+    print_line(f, 0, "    return writer_number(w, id, %d, value, int_width(value));", INTEGER);
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_WRITE_FLOAT).cstr);
+    print_line(f, 0, "    size_t length;");
+    print_line(f, 0, "    uint64_t bits = float_bits(value, &length);");
+    print_line(f, 0, "    return writer_number(w, id, %d, bits, length);", FLOAT);
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_WRITE_STRING).cstr);
+    print_line(f, 0, "    int e = lookup(id);");
+    print_line(f, 0, "    int type = e >= 0 && element_types[e] == %d ? %d : %d;", UTF_8, UTF_8, STRING);
+    print_line(f, 0, "    if (writer_header(w, id, type, length, length) != %s) return %s;", ok.cstr, err.cstr);
+    print_line(f, 0, "    memcpy(w->buf + w->count, value, length);");
+    print_line(f, 0, "    w->count  += length;");
+    print_line(f, 0, "    w->offset += length;");
+    print_line(f, 0, "    return %s;", ok.cstr);
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // large payloads are not copied but passed on to writev, so they have to stay around until the next flush
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_WRITE_BINARY).cstr);
+    print_line(f, 0, "    bool copy = w->fd < 0 || length < %d;", WRITER_COPY_LIMIT);
+    print_line(f, 0, "    if (writer_header(w, id, %d, length, copy ? length : 0) != %s) return %s;", BINARY, ok.cstr, err.cstr);
+    print_line(f, 0, "    if (copy) {");
+    print_line(f, 0, "        memcpy(w->buf + w->count, value, length);");
+    print_line(f, 0, "        w->count += length;");
+    print_line(f, 0, "    } else {");
+    // one iovec for the buffer up to here, one for the payload and one for the buffer after it
+    print_line(f, 0, "        if (w->iov_count + 3 > %d && !writer_writev(w)) return %s;", WRITER_IOV_COUNT, err.cstr);
+    print_line(f, 0, "        if (w->count > w->iov_start) {");
+    print_line(f, 0, "            w->iov[w->iov_count] = (struct iovec) { w->buf + w->iov_start, w->count - w->iov_start };");
+    print_line(f, 0, "            w->iov_count++;");
+    print_line(f, 0, "        }");
+    print_line(f, 0, "        w->iov[w->iov_count] = (struct iovec) { (void *) value, length };");
+    print_line(f, 0, "        w->iov_count++;");
+    print_line(f, 0, "        w->iov_start = w->count;");
+    print_line(f, 0, "    }");
+    print_line(f, 0, "    w->offset += length;");
+    print_line(f, 0, "    return %s;", ok.cstr);
+    print_line(f, 0, "}");
+    fprintf(f, "\n");
+    // without a file descriptor the output is w->buf[0..count)
+    print_line(f, 0, "%s {", api_func_signature(API_FUNC_WRITER_FLUSH).cstr);
+    print_line(f, 0, "    if (w->fd < 0) return %s;", ok.cstr);
+    print_line(f, 0, "    return writer_writev(w) ? %s : %s;", ok.cstr, err.cstr);
+    print_line(f, 0, "}");
+    print_line(f, 0, "#endif");
+}
+
+// Schema ingestion ===========================================================
+
+void read_schema(const char *path) {
+    FILE *schema_file = fopen(path, "r");
+    if (schema_file == NULL) {
+        printf("[ERROR] Could not open file '%s': %s\n", path, strerror(errno));
+        exit(1);
+    }
+    char *chunk = arena_alloc(SCHEMA_READ_BUFSIZE);
+
+    yxml_t parser;
+    yxml_init(&parser, xml_parse_buffer, XML_PARSE_BUFSIZE);
+    Pre_EBML_Element new;
+    bool in_element = false;
+    // the docType attribute of the root, a schema without one is a DocType without a name
+    Short_String doctype_name = {0};
+    size_t doctype = NO_DOCTYPE;
+    size_t n;
+    while ((n = fread(chunk, 1, SCHEMA_READ_BUFSIZE, schema_file)) > 0) {
+        for (size_t i=0; i<n; i++) {
+            yxml_ret_t r = yxml_parse(&parser, chunk[i]);
+            switch (r) {
+                case YXML_EEOF:
+                case YXML_EREF:
+                case YXML_ECLOSE:
+                case YXML_ESTACK:
+                case YXML_ESYN:
+                    UNIMPLEMENTED("parse error handling");
+                case YXML_OK:
+                    break;
+                case YXML_ELEMSTART:
+                    if (strcmp(parser.elem, "element") == 0) {
+                        in_element = true;
+                        init_pre_element(&new);
+                        if (doctype == NO_DOCTYPE) doctype = find_doctype(doctype_name.cstr);
+                    }
+                    break;
+                case YXML_CONTENT:
+                    break;
+                case YXML_ELEMEND:
+                    if (in_element) {
+                        // printf("[INFO] found element:\n");
+                        // print_pre_element(new);
+                        EBML_Element elem = process_element(new);
+                        elem.doctypes = 1 << doctype;
+                        insert_element(elem);
+                        in_element = false;
+                    }
+                    break;
+                case YXML_ATTRSTART:
+                    break;
+                case YXML_ATTRVAL:
+                    if (in_element) {
+                        if (strcmp(parser.attr, "name") == 0) {
+                            append_in_place(&new.name, parser.data);
+                        } else if (strcmp(parser.attr, "path") == 0) {
+                            append_in_place(&new.path, parser.data);
+                        } else if (strcmp(parser.attr, "id") == 0) {
+                            append_in_place(&new.id, parser.data);
+                        } else if (strcmp(parser.attr, "type") == 0) {
+                            append_in_place(&new.type, parser.data);
+                        } else if (strcmp(parser.attr, "range") == 0) {
+                            append_in_place(&new.range, parser.data);
+                        } else if (strcmp(parser.attr, "unknownsizeallowed") == 0) {
+                            append_in_place(&new.unknownsizeallowed, parser.data);
+                        } else if (strcmp(parser.attr, "recursive") == 0) {
+                            append_in_place(&new.recursive, parser.data);
+                        } else if (strcmp(parser.attr, "minOccurs") == 0) {
+                            append_in_place(&new.minoccurs, parser.data);
+                        } else if (strcmp(parser.attr, "maxOccurs") == 0) {
+                            append_in_place(&new.maxoccurs, parser.data);
+                        } else if (strcmp(parser.attr, "length") == 0) {
+                            append_in_place(&new.length, parser.data);
+                        } else if (strcmp(parser.attr, "default") == 0) {
+                            append_in_place(&new.default_value, parser.data);
+                        }
+                    } else if (strcmp(parser.elem, "EBMLSchema") == 0 && strcmp(parser.attr, "docType") == 0) {
+                        append_in_place(&doctype_name, parser.data);
+                    }
+                    break;
+                case YXML_ATTREND:
+                    if (strcmp(parser.elem, "EBMLSchema") == 0 && strcmp(parser.attr, "docType") == 0) {
+                        doctype = find_doctype(doctype_name.cstr);
+                    }
+                    break;
+                case YXML_PISTART:
+                    UNIMPLEMENTED("YXML_PISTART");
+                    break;
+                case YXML_PICONTENT:
+                    UNIMPLEMENTED("YXML_PICONTENT");
+                    break;
+                case YXML_PIEND:
+                    UNIMPLEMENTED("YXML_PIEND");
+                    break;
+            }
         }
     }
     yxml_ret_t r = yxml_eof(&parser);
@@ -1195,14 +4309,444 @@ int main(void) {
         UNIMPLEMENTED("parse error handling");
     }
     fclose(schema_file);
+}
+
+#define SYNTHETIC_FANOUT 16
+#define SYNTHETIC_ROOT_ID 0x1B000001
+#define SYNTHETIC_FIRST_ID 0x210000
+
+// a schema of `count` elements with SYNTHETIC_FANOUT children per master, for timing the generator
+void write_synthetic_schema(FILE *f, size_t count) {
+    fprintf(f, "<EBMLSchema xmlns=\"urn:ietf:rfc:8794\" docType=\"synthetic\" version=\"1\">\n");
+    size_t masters = count > 1 ? (count - 2) / SYNTHETIC_FANOUT + 1 : 1;
+    EBML_Type leaf_types[] = {UINTEGER, INTEGER, FLOAT, STRING, UTF_8, DATE, BINARY};
+    for (size_t i=0; i<count; i++) {
+        // the path of element i is the one of its parent (i-1)/SYNTHETIC_FANOUT and its own name
+        char path[SHORT_STRING_LENGTH] = "";
+        size_t levels[MAX_PATH_DEPTH];
+        size_t depth = 0;
+        for (size_t e=i;; e=(e-1)/SYNTHETIC_FANOUT) {
+            assert(depth < MAX_PATH_DEPTH);
+            levels[depth++] = e;
+            if (e == 0) break;
+        }
+        size_t length = 0;
+        for (size_t l=depth; l>0; l--) length += snprintf(path + length, sizeof(path) - length, "\\Synthetic%zu", levels[l-1]);
+        EBML_Type type = i < masters ? MASTER : leaf_types[i % (sizeof(leaf_types)/sizeof(leaf_types[0]))];
+        fprintf(f, "  <element name=\"Synthetic%zu\" path=\"%s\" id=\"0x%zX\" type=\"%s\"%s%s>\n",
+                i, path, i == 0 ? (size_t) SYNTHETIC_ROOT_ID : SYNTHETIC_FIRST_ID + i, ebml_type_spelling[type],
+                type == UINTEGER ? " range=\"0-1000\"" : "", i == 0 ? " unknownsizeallowed=\"1\"" : "");
+        fprintf(f, "    <documentation lang=\"en\" purpose=\"definition\">Element %zu of a synthetic schema.</documentation>\n", i);
+        fprintf(f, "  </element>\n");
+    }
+    fprintf(f, "</EBMLSchema>\n");
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+// Synthetic corpus ===========================================================
+// a deterministic file for benchmarks: the EBML header, every level 1 element once, then Clusters up to the requested size
+
+typedef struct {
+    uint64_t size;
+    size_t clusters;
+    size_t block_size;
+    size_t frames;
+    size_t nesting;
+    int lacing[4];
+    size_t lacing_count;
+    uint32_t seed;
+} Corpus_Config;
+
+Corpus_Config default_corpus = {
+    .size       = 64*1024*1024,
+    .block_size = 4096,
+    .frames     = 8,
+    // the cursor keeps the end of the file in its first slot, so it opens one master less than that
+    .nesting    = MAX_PATH_DEPTH - 1,
+    // the values of the lacing bits: none, Xiph, fixed and EBML
+    .lacing       = {0, 1, 2, 3},
+    .lacing_count = 4,
+    .seed       = 1,
+};
+
+typedef struct {
+    uint8_t *data;
+    size_t count;
+    size_t capacity;
+} Corpus_Buffer;
+
+void corpus_push(Corpus_Buffer *b, uint8_t x) {
+    if (b->count >= b->capacity) {
+        b->capacity = b->capacity == 0 ? 1024 : 2*b->capacity;
+        b->data = realloc(b->data, b->capacity);
+        assert(b->data != NULL);
+    }
+    b->data[b->count] = x;
+    b->count++;
+}
+
+void corpus_be(Corpus_Buffer *b, uint64_t value, size_t length) {
+    for (size_t i=length; i>0; i--) corpus_push(b, (value >> (8*(i-1))) & 0xFF);
+}
+
+void corpus_id(Corpus_Buffer *b, uint64_t id) {
+    size_t n = 1;
+    while (n < 4 && (id >> (8*n)) != 0) n++;
+    corpus_be(b, id, n);
+}
+
+size_t corpus_vint_width(uint64_t value) {
+    size_t width = 1;
+    while (width < 8 && value >= ((uint64_t) 1 << (7*width)) - 1) width++;
+    return width;
+}
+
+void corpus_vint(Corpus_Buffer *b, uint64_t value, size_t width) {
+    corpus_be(b, value | ((uint64_t) 1 << (7*width)), width);
+}
+
+// masters get an eight byte size that is patched in by corpus_end
+size_t corpus_begin(Corpus_Buffer *b, uint64_t id) {
+    corpus_id(b, id);
+    size_t at = b->count;
+    corpus_vint(b, 0, 8);
+    return at;
+}
+
+void corpus_end(Corpus_Buffer *b, size_t at) {
+    uint64_t marked = (b->count - at - 8) | ((uint64_t) 1 << 56);
+    for (size_t i=0; i<8; i++) b->data[at + i] = (marked >> (8*(7-i))) & 0xFF;
+}
+
+void corpus_number(Corpus_Buffer *b, uint64_t id, uint64_t bits, size_t length) {
+    corpus_id(b, id);
+    corpus_vint(b, length, 1);
+    corpus_be(b, bits, length);
+}
+
+uint32_t corpus_random(uint32_t *seed) {
+    *seed = *seed * 1103515245 + 12345;
+    return *seed >> 8;
+}
+
+// a valid value, as far as the range of the schema tells
+uint64_t corpus_uint(EBML_Range r) {
+    if (r.type == UINTEGER && has_upper_bound(r)) return upper_bound(r);
+    if (r.type == UINTEGER && r.kind == RANGE_LOWER_BOUND) return r.lo_uint + (r.lo_in ? 0 : 1);
+    return 1;
+}
+
+// a SimpleBlock or Block with random frames, laced ones belong to the second track like audio
+void corpus_block(Corpus_Buffer *b, const Corpus_Config *c, uint64_t id, int lacing, bool keyframe, int16_t timecode, uint32_t *seed) {
+    size_t sizes[256];
+    size_t count = lacing == 0 ? 1 : c->frames;
+    size_t average = c->block_size / count > 0 ? c->block_size / count : 1;
+    size_t body = 4 + (lacing == 0 ? 0 : 1);
+    for (size_t i=0; i<count; i++) {
+        sizes[i] = lacing == 2 && i > 0 ? sizes[0] : average/2 + 1 + corpus_random(seed) % average;
+        body += sizes[i];
+    }
+    // the lace sizes are written to a separate buffer first, they are part of the body size
+    Corpus_Buffer lace = {0};
+    for (size_t i=0; i+1<count; i++) {
+        if (lacing == 1) {
+            size_t n = sizes[i];
+            for (; n >= 255; n -= 255) corpus_push(&lace, 255);
+            corpus_push(&lace, n);
+        } else if (lacing == 3 && i == 0) {
+            corpus_vint(&lace, sizes[0], corpus_vint_width(sizes[0]));
+        } else if (lacing == 3) {
+            int64_t delta = (int64_t) sizes[i] - (int64_t) sizes[i-1];
+            size_t width = 1;
+            while (delta < -(((int64_t) 1 << (7*width - 1)) - 1) || delta > ((int64_t) 1 << (7*width - 1)) - 1) width++;
+            corpus_vint(&lace, delta + ((int64_t) 1 << (7*width - 1)) - 1, width);
+        }
+    }
+    body += lace.count;
+    corpus_id(b, id);
+    corpus_vint(b, body, corpus_vint_width(body));
+    corpus_push(b, lacing == 0 ? 0x81 : 0x82);
+    corpus_be(b, (uint16_t) timecode, 2);
+    corpus_push(b, (keyframe ? 0x80 : 0x00) | (lacing << 1));
+    if (lacing != 0) corpus_push(b, count - 1);
+    for (size_t i=0; i<lace.count; i++) corpus_push(b, lace.data[i]);
+    free(lace.data);
+    for (size_t i=0; i<count; i++) {
+        for (size_t j=0; j<sizes[i]; j++) corpus_push(b, corpus_random(seed));
+    }
+}
+
+// the corpus is a file of the first DocType
+bool corpus_has(size_t e) {
+    return element_list[e].doctypes & 1;
+}
+
+// element `e` at level `depth` with one of each of its children
+void corpus_element(Corpus_Buffer *b, const Corpus_Config *c, size_t e, size_t depth, uint32_t *seed) {
+    EBML_Element elem = element_list[e];
+    switch (elem.type) {
+        case MASTER: {
+            size_t at = corpus_begin(b, elem.id);
+            size_t limit = c->nesting < max_depth ? c->nesting : max_depth;
+            for (size_t i=0; i<element_count && depth < limit; i++) {
+                if ((element_parent[i] == e || (i == e && elem.recursive)) && corpus_has(i)) corpus_element(b, c, i, depth + 1, seed);
+            }
+            corpus_end(b, at);
+            break;
+        }
+        case UINTEGER: {
+            uint64_t value = corpus_uint(elem.range);
+            size_t n = 1;
+            while (n < 8 && (value >> (8*n)) != 0) n++;
+            corpus_number(b, elem.id, value, n);
+            break;
+        }
+        case INTEGER:
+            corpus_number(b, elem.id, (uint64_t) -1, 1);
+            break;
+        case DATE:
+            corpus_number(b, elem.id, 0, 8);
+            break;
+        case FLOAT: {
+            double value = 1.0;
+            uint64_t bits;
+            memcpy(&bits, &value, 8);
+            corpus_number(b, elem.id, bits, 8);
+            break;
+        }
+        case STRING:
+        case UTF_8: {
+            const char *value = strcmp(elem.name.cstr, "DocType") == 0 && doctype_count > 0 ? doctype_names[0].cstr : elem.name.cstr;
+            size_t n = strlen(value);
+            corpus_id(b, elem.id);
+            corpus_vint(b, n, 1);
+            for (size_t i=0; i<n; i++) corpus_push(b, value[i]);
+            break;
+        }
+        case BINARY:
+            if (strcmp(elem.name.cstr, "SimpleBlock") == 0 || strcmp(elem.name.cstr, "Block") == 0) {
+                corpus_block(b, c, elem.id, 0, true, 0, seed);
+                break;
+            }
+            corpus_id(b, elem.id);
+            corpus_vint(b, 4, 1);
+            corpus_be(b, corpus_random(seed), 4);
+            break;
+        case EBML_TYPE_COUNT:
+            UNREACHABLE("EBML_TYPE_COUNT is not a valid type");
+    }
+}
+
+// the blocks cycle through the lacings, every eighth unlaced one is in a BlockGroup if the schema has them
+void corpus_cluster(Corpus_Buffer *b, const Corpus_Config *c, size_t blocks, uint64_t timestamp, uint32_t *seed) {
+    size_t cluster          = find_element("\\Segment\\Cluster");
+    size_t cluster_time     = find_element("\\Segment\\Cluster\\Timestamp");
+    size_t simple_block     = find_element("\\Segment\\Cluster\\SimpleBlock");
+    size_t block_group      = find_element("\\Segment\\Cluster\\BlockGroup");
+    size_t block            = find_element("\\Segment\\Cluster\\BlockGroup\\Block");
+    size_t at = corpus_begin(b, element_list[cluster].id);
+    if (cluster_time != NO_ELEMENT) corpus_number(b, element_list[cluster_time].id, timestamp, 8);
+    for (size_t i=0; i<blocks; i++) {
+        int lacing = c->lacing[i % c->lacing_count];
+        int16_t timecode = i;
+        if ((lacing == 0 && i % 8 == 7 && block_group != NO_ELEMENT && block != NO_ELEMENT) || simple_block == NO_ELEMENT) {
+            size_t group = corpus_begin(b, element_list[block_group].id);
+            corpus_block(b, c, element_list[block].id, lacing, false, timecode, seed);
+            corpus_end(b, group);
+        } else {
+            corpus_block(b, c, element_list[simple_block].id, lacing, i == 0, timecode, seed);
+        }
+    }
+    corpus_end(b, at);
+}
+
+bool corpus_flush(FILE *f, Corpus_Buffer *b) {
+    bool ok = fwrite(b->data, 1, b->count, f) == b->count;
+    b->count = 0;
+    return ok;
+}
+
+void write_corpus(const char *path, Corpus_Config c) {
+    size_t ebml    = find_element("\\EBML");
+    size_t segment = find_element("\\Segment");
+    size_t cluster = find_element("\\Segment\\Cluster");
+    if (ebml == NO_ELEMENT || segment == NO_ELEMENT || cluster == NO_ELEMENT
+        || (find_element("\\Segment\\Cluster\\SimpleBlock") == NO_ELEMENT && find_element("\\Segment\\Cluster\\BlockGroup\\Block") == NO_ELEMENT)) {
+        printf("[ERROR] a corpus needs a schema with Segment, Cluster and SimpleBlock or Block\n");
+        exit(1);
+    }
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        printf("[ERROR] Could not open file '%s': %s\n", path, strerror(errno));
+        exit(1);
+    }
+    uint32_t seed = c.seed;
+    Corpus_Buffer b = {0};
+    corpus_element(&b, &c, ebml, 1, &seed);
+    // the Segment is too large to be kept in memory, its size is patched in the file at the end
+    size_t segment_size_at = corpus_begin(&b, element_list[segment].id);
+    uint64_t segment_body = b.count;
+    for (size_t i=0; i<element_count; i++) {
+        if (element_parent[i] == segment && i != cluster && corpus_has(i)) corpus_element(&b, &c, i, 2, &seed);
+    }
+    uint64_t written = b.count;
+    bool ok = corpus_flush(f, &b);
+    size_t clusters = c.clusters > 0 ? c.clusters : (c.size + (1 << 20) - 1) >> 20;
+    size_t blocks = c.size / clusters / (c.block_size + 16);
+    if (blocks == 0) blocks = 1;
+    for (size_t i=0; i<clusters && ok; i++) {
+        corpus_cluster(&b, &c, blocks, i*1000, &seed);
+        written += b.count;
+        ok = corpus_flush(f, &b);
+    }
+    uint64_t marked = (written - segment_body) | ((uint64_t) 1 << 56);
+    for (size_t i=0; i<8; i++) corpus_push(&b, (marked >> (8*(7-i))) & 0xFF);
+    ok = ok && fseek(f, segment_size_at, SEEK_SET) == 0 && corpus_flush(f, &b);
+    if (fclose(f) != 0 || !ok) {
+        printf("[ERROR] Could not write file '%s': %s\n", path, strerror(errno));
+        exit(1);
+    }
+    free(b.data);
+    printf("[INFO] wrote %lu bytes with %zu clusters of %zu blocks to '%s'\n", written, clusters, blocks, path);
+}
+
+#ifndef UNIT_TESTING
+const char *lacing_names[] = {"none", "xiph", "fixed", "ebml"};
+
+// a comma separated list of lacing names
+bool parse_lacing(const char *list, Corpus_Config *c) {
+    c->lacing_count = 0;
+    while (*list != '\0') {
+        size_t n = strcspn(list, ",");
+        bool found = false;
+        for (int i=0; i<4 && !found; i++) {
+            if (strlen(lacing_names[i]) != n || strncmp(list, lacing_names[i], n) != 0) continue;
+            if (c->lacing_count == 4) return false;
+            c->lacing[c->lacing_count++] = i;
+            found = true;
+        }
+        if (!found) return false;
+        list += n;
+        if (*list == ',') list++;
+    }
+    return c->lacing_count > 0;
+}
+
+void usage(const char *program) {
+    printf("Usage: %s [--lean] [--schema <file>]... [--output <file>]\n", program);
+    printf("       %s --synthetic-schema <file> [--elements <n>]\n", program);
+    printf("       %s --switch-lookup <file>\n", program);
+    printf("       %s --corpus <file> [--size <MiB>] [--clusters <n>] [--block-size <bytes>] [--frames <n>]\n", program);
+    printf("       %*s [--lacing none,xiph,fixed,ebml] [--nesting <depth>] [--seed <n>]\n", (int) strlen(program), "");
+}
+
+int main(int argc, char **argv) {
+    // every schema is a DocType of the generated library
+    const char *schema_paths[MAX_DOCTYPES] = {SCHEMA_FILE_NAME};
+    size_t schema_count = 0;
+    const char *output_path = NULL;
+    const char *synthetic_path = NULL;
+    size_t synthetic_count = 20000;
+    const char *corpus_path = NULL;
+    const char *switch_path = NULL;
+    Corpus_Config corpus = default_corpus;
+    for (int i=1; i<argc; i++) {
+        // every option but --lean takes a value
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--lean") == 0) {
+            lean_state = true;
+        } else if (strcmp(argv[i], "--schema") == 0 && has_value) {
+            if (schema_count == MAX_DOCTYPES) {
+                printf("[ERROR] more than %d schemas\n", MAX_DOCTYPES);
+                exit(1);
+            }
+            schema_paths[schema_count++] = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0 && has_value) {
+            output_path = argv[++i];
+        } else if (strcmp(argv[i], "--synthetic-schema") == 0 && has_value) {
+            synthetic_path = argv[++i];
+        } else if (strcmp(argv[i], "--elements") == 0 && has_value) {
+            synthetic_count = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--switch-lookup") == 0 && has_value) {
+            switch_path = argv[++i];
+        } else if (strcmp(argv[i], "--corpus") == 0 && has_value) {
+            corpus_path = argv[++i];
+        } else if (strcmp(argv[i], "--size") == 0 && has_value) {
+            corpus.size = strtoull(argv[++i], NULL, 10) << 20;
+        } else if (strcmp(argv[i], "--clusters") == 0 && has_value) {
+            corpus.clusters = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--block-size") == 0 && has_value) {
+            corpus.block_size = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--frames") == 0 && has_value) {
+            corpus.frames = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--nesting") == 0 && has_value) {
+            corpus.nesting = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && has_value) {
+            corpus.seed = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--lacing") == 0 && has_value) {
+            if (!parse_lacing(argv[++i], &corpus)) {
+                printf("[ERROR] invalid lacing list '%s'\n", argv[i]);
+                usage(argv[0]);
+                exit(1);
+            }
+        } else {
+            printf("[ERROR] unknown argument '%s'\n", argv[i]);
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+    // a lace has at most 256 frames
+    if (corpus.size == 0 || corpus.block_size == 0 || corpus.frames < 1 || corpus.frames > 256) {
+        printf("[ERROR] the corpus needs a size, a block size and 1 to 256 frames per lace\n");
+        exit(1);
+    }
+    if (synthetic_path != NULL) {
+        FILE *synthetic_file = fopen(synthetic_path, "w");
+        if (synthetic_file == NULL) {
+            printf("[ERROR] Could not open file '%s': %s\n", synthetic_path, strerror(errno));
+            exit(1);
+        }
+        write_synthetic_schema(synthetic_file, synthetic_count);
+        fclose(synthetic_file);
+        printf("[INFO] wrote a schema with %zu elements to '%s'\n", synthetic_count, synthetic_path);
+        return 0;
+    }
+    if (schema_count == 0) schema_count = 1;
+    append_default_elements();
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i=0; i<schema_count; i++) read_schema(schema_paths[i]);
+    double read_seconds = seconds_since(start);
+
+    compute_parents();
+    compute_max_depth();
+    compute_occurrences();
+    compute_defaults();
+    build_perfect_hash();
+    double schema_seconds = seconds_since(start);
+
+    if (corpus_path != NULL) {
+        write_corpus(corpus_path, corpus);
+        return 0;
+    }
+    if (switch_path != NULL) {
+        write_switch_lookup(switch_path);
+        return 0;
+    }
 
     printf("[INFO] the following paths exist in the schema:\n");
     for (size_t i=0; i<element_count; i++) {
         path_print(element_list[i].path);
     }
 
-    Short_String target_file_name        = shortf("build/%s.h", TARGET_LIBRARY_NAME);
-    Short_String include_guard           = capitalize(shortf("%s_H", TARGET_LIBRARY_NAME));
+    Short_String target_name             = shortf("%s%s", TARGET_LIBRARY_NAME, lean_state ? "_lean" : "");
+    Short_String target_file_name        = output_path != NULL ? shortf("%s", output_path) : shortf("build/%s.h", target_name.cstr);
+    Short_String include_guard           = capitalize(shortf("%s_H", target_name.cstr));
     Short_String implementation_guard    = capitalize(shortf("%s_IMPLEMENTATION", TARGET_LIBRARY_NAME));
 
     FILE *target_file = fopen(target_file_name.cstr, "w");
@@ -1221,6 +4765,16 @@ int main(void) {
     print_line(target_file, 0, "#include <assert.h>");
     print_line(target_file, 0, "#include <stdint.h>");
     print_line(target_file, 0, "#include <stdbool.h>");
+    print_line(target_file, 0, "#include <stddef.h>");
+    print_line(target_file, 0, "#include <stdlib.h>");
+    print_line(target_file, 0, "#include <string.h>");
+    line();
+
+    // the deepest level of the schema, including the allowance for recursive elements
+    print_line(target_file, 0, "#define %s_MAX_DEPTH %zu", PREFIX_CAPS.cstr, max_depth);
+    // the number of elements in the schema, tables indexed by the `index` of an element have this size
+    print_line(target_file, 0, "#define %s_ELEMENT_COUNT %zu", PREFIX_CAPS.cstr, element_count);
+    if (lean_state) print_line(target_file, 0, "#define %s_LEAN", PREFIX_CAPS.cstr);
     line();
 
     // type definitions
@@ -1236,11 +4790,55 @@ int main(void) {
     }
     print_line(target_file, 0, "};");
     line();
+    print_line(target_file, 0, "enum {");
+    for (EBML_Type i=0; i<EBML_TYPE_COUNT; i++) {
+        print_line(target_file, 1, "%s_TYPE_%s = %d,", PREFIX_CAPS.cstr, c_identifier(capitalize(shortf("%s", ebml_type_spelling[i]))).cstr, i);
+    }
+    print_line(target_file, 0, "};");
+    line();
+    if (multiple_doctypes()) {
+        // the DocTypes of the schemas, a parser accepts the elements of the one named in the EBML header
+        print_line(target_file, 0, "enum {");
+        print_line(target_file, 1, "%s_DOCTYPE_ANY = 0,", PREFIX_CAPS.cstr);
+        for (size_t t=0; t<doctype_count; t++) {
+            print_line(target_file, 1, "%s_DOCTYPE_%s = %zu,", PREFIX_CAPS.cstr, c_identifier(capitalize(doctype_names[t])).cstr, t + 1);
+        }
+        print_line(target_file, 0, "};");
+        print_line(target_file, 0, "#define %s_DOCTYPE_COUNT %zu", PREFIX_CAPS.cstr, doctype_count + 1);
+        line();
+    }
+    // the size of a top level element of unknown size, the largest one that fits into a vint
+    print_line(target_file, 0, "#define %s_UNKNOWN_SIZE 0x00FFFFFFFFFFFFFF", PREFIX_CAPS.cstr);
+    line();
+    if (supports_blocks()) {
+        // the lacing bits of the block flags, a lace has at most 256 frames
+        print_line(target_file, 0, "enum {");
+        print_line(target_file, 1, "%s_LACING_NONE  = 0,", PREFIX_CAPS.cstr);
+        print_line(target_file, 1, "%s_LACING_XIPH  = 1,", PREFIX_CAPS.cstr);
+        print_line(target_file, 1, "%s_LACING_FIXED = 2,", PREFIX_CAPS.cstr);
+        print_line(target_file, 1, "%s_LACING_EBML  = 3,", PREFIX_CAPS.cstr);
+        print_line(target_file, 0, "};");
+        print_line(target_file, 0, "#define %s_MAX_FRAMES 256", PREFIX_CAPS.cstr);
+        line();
+    }
 
     // function declarations
     for (size_t i=0; i<API_FUNC_COUNT; i++) {
+        if (i == API_FUNC_SEEK_TIME && !supports_seek()) continue;
+        if (i == API_FUNC_BLOCK_DECODE && !supports_blocks()) continue;
+        if (i == API_FUNC_PARSE_PARALLEL || i == API_FUNC_STATS_DUMP) {
+            // needs pthreads or costs time per element, so it is opt-in
+            print_line(target_file, 0, "#ifdef %s_%s", PREFIX_CAPS.cstr, i == API_FUNC_PARSE_PARALLEL ? "PARALLEL" : "STATS");
+            print_line(target_file, 0, "%s;", api_func_signature(i).cstr);
+            print_line(target_file, 0, "#endif");
+            continue;
+        }
+        // needs writev and pwrite, so it is only there where mmap is
+        if (i == API_FUNC_WRITER_INIT)  print_line(target_file, 0, "#if %s", POSIX_GUARD);
         print_line(target_file, 0, "%s;", api_func_signature(i).cstr);
+        if (i == API_FUNC_WRITER_FLUSH) print_line(target_file, 0, "#endif");
     }
+    declare_mmap_funcs(target_file);
 
     line();
     print_line(target_file, 0, "#endif // %s", include_guard.cstr);
@@ -1255,26 +4853,88 @@ int main(void) {
     line();
     implement_drop_first_active_bit(target_file);
     line();
-    implement_type(target_file);
+    implement_load_be(target_file);
+    line();
+    implement_vint_decode(target_file);
     line();
-    implement_name(target_file);
+    implement_element_table(target_file);
+    line();
+    implement_lookup(target_file);
+    line();
+    implement_default_funcs(target_file);
+    line();
+    implement_filter_funcs(target_file);
+    line();
+    implement_read_funcs(target_file);
     line();
     implement_incdepth_func(target_file);
     line();
     implement_decdepth_func(target_file);
     line();
+    implement_validation_funcs(target_file);
+    line();
+    implement_header_funcs(target_file);
+    line();
+    implement_finish_number_func(target_file);
+    line();
     implement_init_func(target_file);
     line();
+    implement_init_at_func(target_file);
+    line();
+    implement_stats_funcs(target_file);
+    line();
     implement_parse_func(target_file);
     line();
+    implement_parse_entry(target_file, API_FUNC_PARSE, "parse_byte", "p, b");
+    line();
+    implement_parse_buffer_func(target_file);
+    line();
+    implement_parse_entry(target_file, API_FUNC_PARSE_BUFFER, "parse_bytes", "p, buf, len, consumed");
+    line();
+    implement_skip_func(target_file);
+    line();
+    implement_current_func(target_file);
+    line();
+    implement_value_or_default_func(target_file);
+    line();
     implement_eof_func(target_file);
     line();
     implement_print_func(target_file);
+    line();
+    implement_cursor_init_func(target_file);
+    line();
+    implement_next_func(target_file);
+    line();
+    implement_visit_func(target_file);
+    line();
+    if (supports_seek()) {
+        implement_seek_funcs(target_file);
+        line();
+    }
+    implement_scan_children_func(target_file);
+    line();
+    implement_resync_funcs(target_file);
+    line();
+    implement_parse_parallel_func(target_file);
+    line();
+    if (supports_blocks()) {
+        implement_block_decode_func(target_file);
+        line();
+    }
+    implement_encode_funcs(target_file);
+    line();
+    implement_serialize_funcs(target_file);
+    line();
+    implement_mmap_funcs(target_file);
+    line();
+    implement_writer_funcs(target_file);
 
     line();
     print_line(target_file, 0, "#endif // %s", implementation_guard.cstr);
     // ==============================================
 
     fclose(target_file);
+    printf("[INFO] read %zu elements of %zu DocType%s in %.1f ms, schema tables in %.1f ms, wrote '%s' after %.1f ms\n",
+           element_count, doctype_count, doctype_count == 1 ? "" : "s", read_seconds*1e3, (schema_seconds - read_seconds)*1e3, target_file_name.cstr, seconds_since(start)*1e3);
 }
 #endif //UNIT_TESTING
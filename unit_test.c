@@ -173,6 +173,149 @@ bool path_equal(EBML_Path p1, EBML_Path p2) {
     return true;
 }
 
+bool perfect_hash_test(size_t count) {
+    element_count = 0;
+    uint64_t id = 0x80;
+    for (size_t i=0; i<count; i++) {
+        id = id * 6364136223846793005 + 1442695040888963407;
+        append_element((EBML_Element) {.id = id >> 36});
+    }
+    build_perfect_hash();
+    bool *used = arena_alloc(element_count * sizeof(*used));
+    for (size_t i=0; i<element_count; i++) {
+        size_t slot = perfect_hash_slot(element_list[i].id);
+        if (slot >= element_count || used[slot] || slot != element_slot[i] || slot_element[slot] != i) return false;
+        used[slot] = true;
+    }
+    return true;
+}
+
+// the synthetic schema goes through read_schema like a vendor schema would
+bool synthetic_schema_test(size_t count) {
+    element_count = 0;
+    char path[] = "/tmp/synthetic_schema_XXXXXX";
+    int fd = mkstemp(path);
+    FILE *f = fd < 0 ? NULL : fdopen(fd, "w");
+    if (f == NULL) return false;
+    write_synthetic_schema(f, count);
+    fclose(f);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    read_schema(path);
+    compute_parents();
+    build_perfect_hash();
+    printf("[INFO] read %zu elements and built their tables in %.1f ms\n", element_count, seconds_since(start)*1e3);
+    remove(path);
+    if (element_count != count) return false;
+    for (size_t i=0; i<count; i++) {
+        uint64_t id = i == 0 ? SYNTHETIC_ROOT_ID : SYNTHETIC_FIRST_ID + i;
+        size_t parent = i == 0 ? NO_PARENT : (i - 1) / SYNTHETIC_FANOUT;
+        if (find_id(id) != i || element_parent[i] != parent || perfect_hash_slot(id) != element_slot[i]) return false;
+    }
+    return true;
+}
+
+// webm.xml is a subset of example.xml, so merging it must not add a single element
+bool doctype_test(void) {
+    element_count = 0;
+    doctype_count = 0;
+    append_default_elements();
+    read_schema("example.xml");
+    size_t matroska_count = element_count;
+    read_schema("webm.xml");
+    compute_parents();
+    if (element_count != matroska_count || doctype_count != 2) return false;
+    if (strcmp(doctype_names[0].cstr, "matroska") != 0 || strcmp(doctype_names[1].cstr, "webm") != 0) return false;
+    if (element_list[find_element("\\EBML\\DocType")].doctypes != ALL_DOCTYPES) return false;
+    if (element_list[find_element("\\Segment\\Cluster\\SimpleBlock")].doctypes != 3) return false;
+    if (element_list[find_element("\\Segment\\Cluster\\SilentTracks")].doctypes != 1) return false;
+    // every element of webm is inside of a webm element
+    for (size_t i=0; i<element_count; i++) {
+        size_t parent = element_parent[i];
+        if ((element_list[i].doctypes & 2) && parent != NO_PARENT && !(element_list[parent].doctypes & 2)) return false;
+    }
+    return true;
+}
+
+// Info has to be in a Segment once, TrackUID in every TrackEntry, the many SimpleBlocks and the TimestampScale with a default are not counted
+bool occurrences_test(void) {
+    element_count = 0;
+    doctype_count = 0;
+    append_default_elements();
+    read_schema("example.xml");
+    compute_parents();
+    compute_occurrences();
+    size_t segment  = find_element("\\Segment");
+    size_t info     = find_element("\\Segment\\Info");
+    size_t entry    = find_element("\\Segment\\Tracks\\TrackEntry");
+    size_t uid      = find_element("\\Segment\\Tracks\\TrackEntry\\TrackUID");
+    size_t scale    = find_element("\\Segment\\Info\\TimestampScale");
+    size_t block    = find_element("\\Segment\\Cluster\\SimpleBlock");
+    if (!(element_occurs[info] & OCCURS_ONCE) || !((element_required[segment] >> (element_occurs[info] & (OCCURS_ONCE - 1))) & 1)) return false;
+    if (element_occurs[uid] == NO_OCCURS || !((element_required[entry] >> (element_occurs[uid] & (OCCURS_ONCE - 1))) & 1)) return false;
+    if (element_occurs[block] != NO_OCCURS) return false;
+    // it may only be there once, but it does not have to be
+    if (!(element_occurs[scale] & OCCURS_ONCE) || ((element_required[info] >> (element_occurs[scale] & (OCCURS_ONCE - 1))) & 1)) return false;
+    return true;
+}
+
+bool defaults_test(void) {
+    element_count = 0;
+    doctype_count = 0;
+    append_default_elements();
+    read_schema("example.xml");
+    compute_parents();
+    compute_defaults();
+    size_t scale     = find_element("\\Segment\\Info\\TimestampScale");
+    size_t frequency = find_element("\\Segment\\Tracks\\TrackEntry\\Audio\\SamplingFrequency");
+    size_t language  = find_element("\\Segment\\Tracks\\TrackEntry\\Language");
+    size_t number    = find_element("\\Segment\\Tracks\\TrackEntry\\TrackNumber");
+    size_t entry     = find_element("\\Segment\\Tracks\\TrackEntry");
+    if (strcmp(element_default_row[scale].cstr, ".value = 1000000") != 0) return false;
+    if (strcmp(element_default_row[frequency].cstr, ".float_value = 0x1.f4p+12") != 0) return false;
+    if (strcmp(element_default_row[language].cstr, ".string = \"eng\", .string_length = 3") != 0) return false;
+    if (element_default_row[number].cstr[0] != '\0' || element_default_bit[number] != NO_DEFAULT_BIT) return false;
+    // the children of a master with a default are numbered from 0 on
+    uint64_t bits = 0;
+    for (size_t i=0; i<element_count; i++) {
+        if (element_parent[i] != entry || element_default_bit[i] == NO_DEFAULT_BIT) continue;
+        if (element_default_bit[i] >= element_default_children[entry] || (bits >> element_default_bit[i]) & 1) return false;
+        bits |= (uint64_t) 1 << element_default_bit[i];
+    }
+    return element_default_children[entry] > 0 && bits == ((uint64_t) 1 << element_default_children[entry]) - 1;
+}
+
+typedef struct {
+    const char *path;
+    EBML_Type type;
+} Depth_Test_Element;
+
+size_t max_depth_test(const Depth_Test_Element *elems, size_t count) {
+    element_count = 0;
+    for (size_t i=0; i<count; i++) {
+        append_element((EBML_Element) {.path = parse_path(shortf("%s", elems[i].path)), .type = elems[i].type});
+    }
+    compute_max_depth();
+    return max_depth;
+}
+
+// a recursive leaf is the deepest element
+Depth_Test_Element depth_test_recursive[] = {
+    {"\\Segment", MASTER},
+    {"\\Segment\\Chapters", MASTER},
+    {"\\Segment\\Chapters\\+ChapterAtom", MASTER},
+    {"\\Segment\\Chapters\\+ChapterAtom\\ChapString", UTF_8},
+    {"\\(-\\)Void", BINARY},
+};
+
+// a global element inside of the deepest master element is the deepest element
+Depth_Test_Element depth_test_global[] = {
+    {"\\Segment", MASTER},
+    {"\\Segment\\Info", MASTER},
+    {"\\Segment\\Info\\Title", UTF_8},
+    {"\\(1-\\)CRC-32", BINARY},
+};
+
 int main() {
     bool failure = false;
     for (size_t i=0; i<range_test_count; i++) {
@@ -206,6 +349,69 @@ int main() {
         }
     }
 
+    size_t perfect_hash_sizes[] = {1, 2, 3, 17, 271, 512, 20000};
+    for (size_t i=0; i<sizeof(perfect_hash_sizes)/sizeof(perfect_hash_sizes[0]); i++) {
+        printf("[INFO] running `build_perfect_hash` on %zu ids\n", perfect_hash_sizes[i]);
+        if (perfect_hash_test(perfect_hash_sizes[i])) {
+            printf("[INFO] test passed\n");
+        } else {
+            failure = true;
+            printf("[ERROR] test not passed\n");
+        }
+    }
+
+    printf("[INFO] running `read_schema` on a synthetic schema\n");
+    if (synthetic_schema_test(20000)) {
+        printf("[INFO] test passed\n");
+    } else {
+        failure = true;
+        printf("[ERROR] test not passed\n");
+    }
+
+    printf("[INFO] running `read_schema` on the matroska and webm schemas\n");
+    if (doctype_test()) {
+        printf("[INFO] test passed\n");
+    } else {
+        failure = true;
+        printf("[ERROR] test not passed\n");
+    }
+
+    printf("[INFO] running `compute_occurrences` on the matroska schema\n");
+    if (occurrences_test()) {
+        printf("[INFO] test passed\n");
+    } else {
+        failure = true;
+        printf("[ERROR] test not passed\n");
+    }
+
+    printf("[INFO] running `compute_defaults` on the matroska schema\n");
+    if (defaults_test()) {
+        printf("[INFO] test passed\n");
+    } else {
+        failure = true;
+        printf("[ERROR] test not passed\n");
+    }
+
+    struct {
+        const char *name;
+        const Depth_Test_Element *elems;
+        size_t count;
+        size_t expected;
+    } depth_tests[] = {
+        {"recursive", depth_test_recursive, sizeof(depth_test_recursive)/sizeof(depth_test_recursive[0]), 4 + MAX_RECURSION},
+        {"global",    depth_test_global,    sizeof(depth_test_global)/sizeof(depth_test_global[0]),    3},
+    };
+    for (size_t i=0; i<sizeof(depth_tests)/sizeof(depth_tests[0]); i++) {
+        printf("[INFO] running `compute_max_depth` on the %s schema\n", depth_tests[i].name);
+        size_t depth = max_depth_test(depth_tests[i].elems, depth_tests[i].count);
+        if (depth == depth_tests[i].expected) {
+            printf("[INFO] test passed\n");
+        } else {
+            failure = true;
+            printf("[ERROR] test not passed, expected %zu but got %zu\n", depth_tests[i].expected, depth);
+        }
+    }
+
     if (failure) {
         printf("[INFO] some tests have failed\n");
         exit(1);